@@ -12,38 +12,108 @@
 #include <memory>
 #include <limits>
 #include <string>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <cerrno>
+#include <mutex>
+#include <pthread.h>
+#include <ostream>
+#include "latency_histogram.hpp"
 
+// What release() does when the previous job hasn't finished yet (a deadline miss):
+//  - Queue:    keep every release, up to queueBound pending (0 = unbounded)
+//  - Coalesce: keep at most one pending release
+//  - Skip:     drop releases that arrive while a job is running or pending
+enum class OverrunPolicy { Queue, Coalesce, Skip };
+
+struct ServiceSnapshot
+{
+    std::string name;
+    uint32_t period;
+    HistogramSnapshot execTime;
+    HistogramSnapshot releaseLatency;
+    uint64_t deadlineMisses;
+    uint64_t droppedReleases;
+};
+
+// A service with period 0 is event-driven: it has no timer and only runs
+// when a producer calls release().
 class Service
 {
 public:
     uint32_t getPeriod() const { return _period; }
+    bool isEventDriven() const { return _period == 0; }
     std::string service_name;
 
     template<typename T>
-    Service(std::string name, T&& doService, uint8_t affinity, uint8_t priority, uint32_t period) :
+    Service(std::string name, T&& doService, uint8_t affinity, uint8_t priority, uint32_t period,
+            OverrunPolicy policy = OverrunPolicy::Queue, uint32_t queueBound = 0) :
         _doService(doService)
     {
         service_name = std::move(name);
         _affinity = affinity;
         _priority = priority;
         _period = period;
+        _policy = policy;
+        _queueBound = queueBound;
         _isRunning = true;
         sem_init(&_releaseSem, 0, 0);
         _service = std::jthread(&Service::_provideService, this);
     }
 
-    void stop()
+    // Stops taking releases and wakes the worker. Other services may still
+    // call release() on this one afterwards; those calls do nothing.
+    void beginStop()
     {
         _isRunning = false;
+        // A release() that saw _isRunning still set finishes its post first
+        while (_releasing.load() > 0) std::this_thread::yield();
         sem_post(&_releaseSem);
+    }
+
+    // Waits for the worker to finish its current job and exit
+    void join()
+    {
+        if (!_service.joinable()) return;
         _service.request_stop();
+        _service.join();
+    }
+
+    // Stops and joins the worker, then frees the semaphore. With several
+    // services releasing each other, call beginStop() and join() on all of
+    // them first (Sequencer::stopServices() does).
+    void stop()
+    {
+        if (_isRunning) beginStop();
+        join();
         sem_destroy(&_releaseSem);
         logStatistics();
     }
 
+    // Lock-free view of the histograms, callable from any thread while running
+    ServiceSnapshot snapshot() const
+    {
+        return {service_name, _period, _execHist.snapshot(), _releaseHist.snapshot(),
+                _deadlineMisses.load(std::memory_order_relaxed), _droppedReleases.load(std::memory_order_relaxed)};
+    }
+
     void release()
     {
-        sem_post(&_releaseSem);
+        _releasing++;
+        if (_isRunning) _release(false);
+        _releasing--;
+    }
+
+    // A release of a periodic service on top of its timer (a scheduled or
+    // triggered capture). Runs the same way, but is left out of the start
+    // jitter, which only compares timer releases.
+    void releaseExtra()
+    {
+        _releasing++;
+        if (_isRunning) _release(true);
+        _releasing--;
     }
 
 private:
@@ -51,11 +121,53 @@ private:
     std::jthread _service;
     sem_t _releaseSem;
     std::atomic<bool> _isRunning;
+    // release() calls in progress, so beginStop() can wait them out
+    std::atomic<int> _releasing{0};
+
+    void _release(bool extra)
+    {
+        uint32_t pending = _pending.load();
+        if (pending > 0 || _busy.load()) _deadlineMisses++;
+
+        uint32_t limit;
+        switch (_policy) {
+        case OverrunPolicy::Skip:
+            limit = _busy.load() ? 0 : 1;
+            break;
+        case OverrunPolicy::Coalesce:
+            limit = 1;
+            break;
+        default:
+            limit = _queueBound ? _queueBound : std::numeric_limits<uint32_t>::max();
+            break;
+        }
+        do {
+            if (pending >= limit) {
+                _droppedReleases++;
+                return;
+            }
+        } while (!_pending.compare_exchange_weak(pending, pending + 1));
+
+        // Only a release that found nothing pending is timed, see _lastReleaseNs
+        if (pending == 0) {
+            _lastReleaseExtra.store(extra, std::memory_order_relaxed);
+            _lastReleaseNs.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                                 std::memory_order_release);
+        }
+        sem_post(&_releaseSem);
+    }
 
     uint8_t _affinity;
     uint8_t _priority;
     uint32_t _period;
 
+    OverrunPolicy _policy;
+    uint32_t _queueBound;
+    std::atomic<uint32_t> _pending{0};
+    std::atomic<bool> _busy{false};
+    std::atomic<uint64_t> _deadlineMisses{0};
+    std::atomic<uint64_t> _droppedReleases{0};
+
     std::chrono::high_resolution_clock::time_point _lastStartTime;
     double _minExecTime = std::numeric_limits<double>::max();
     double _maxExecTime = 0.0;
@@ -64,6 +176,21 @@ private:
 
     double _minStartJitter = std::numeric_limits<double>::max();
     double _maxStartJitter = 0.0;
+    bool _haveTimerStart = false;   // _lastStartTime is a timer release's start
+
+    // Release-to-start latency, for both timer and event releases. Only
+    // the release that made _pending go from 0 to 1 stamps its time; the
+    // job it starts takes the stamp (leaving 0), so releases queued behind
+    // a running or pending one have no stamp and aren't counted here.
+    std::atomic<int64_t> _lastReleaseNs{0};
+    std::atomic<bool> _lastReleaseExtra{false};
+    double _minReleaseLatency = std::numeric_limits<double>::max();
+    double _maxReleaseLatency = 0.0;
+    double _totalReleaseLatency = 0.0;
+    int _releaseLatencyCount = 0;
+
+    LatencyHistogram _execHist;
+    LatencyHistogram _releaseHist;
 
     void _initializeService()
     {
@@ -92,29 +219,68 @@ private:
             sem_wait(&_releaseSem);
 
             if (_isRunning) {
+                _busy = true;
+                // Take the stamp before _pending drops, so the next release
+                // can't stamp over it
+                int64_t releaseNs = _lastReleaseNs.exchange(0, std::memory_order_acquire);
+                bool extra = _lastReleaseExtra.load(std::memory_order_relaxed);
+                _pending--;
                 auto start = std::chrono::high_resolution_clock::now();
 
-                if (_executionCount > 0) {
-                    double actualInterval = std::chrono::duration<double, std::milli>(start - _lastStartTime).count();
-                    double expectedInterval = _period;
-                    double jitter = std::abs(actualInterval - expectedInterval);
-                    _minStartJitter = std::min(_minStartJitter, jitter);
-                    _maxStartJitter = std::max(_maxStartJitter, jitter);
+                if (releaseNs != 0) {
+                    auto releaseTime = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(releaseNs));
+                    double releaseLatency = std::max(0.0, std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - releaseTime).count());
+                    _minReleaseLatency = std::min(_minReleaseLatency, releaseLatency);
+                    _maxReleaseLatency = std::max(_maxReleaseLatency, releaseLatency);
+                    _totalReleaseLatency += releaseLatency;
+                    _releaseLatencyCount++;
+                    _releaseHist.record(releaseLatency);
+                }
+
+                // Start jitter between consecutive timer releases; an extra
+                // release in between doesn't move the timer, a queued one
+                // (no stamp, source unknown) starts the comparison over
+                if (!isEventDriven() && releaseNs == 0) {
+                    _haveTimerStart = false;
+                } else if (!isEventDriven() && !extra) {
+                    if (_haveTimerStart) {
+                        double actualInterval = std::chrono::duration<double, std::milli>(start - _lastStartTime).count();
+                        double expectedInterval = _period;
+                        double jitter = std::abs(actualInterval - expectedInterval);
+                        _minStartJitter = std::min(_minStartJitter, jitter);
+                        _maxStartJitter = std::max(_maxStartJitter, jitter);
+                    }
+                    _lastStartTime = start;
+                    _haveTimerStart = true;
                 }
-                _lastStartTime = start;
 
                 _doService();
+                _busy = false;
 
                 auto end = std::chrono::high_resolution_clock::now();
                 double execTime = std::chrono::duration<double, std::milli>(end - start).count();
                 _minExecTime = std::min(_minExecTime, execTime);
                 _maxExecTime = std::max(_maxExecTime, execTime);
                 _totalExecTime += execTime;
+                _execHist.record(execTime);
                 _executionCount++;
             }
         }
     }
 
+    const char* _policyName() const
+    {
+        switch (_policy) {
+        case OverrunPolicy::Skip:
+            return "skip";
+        case OverrunPolicy::Coalesce:
+            return "coalesce";
+        default:
+            return "queue";
+        }
+    }
+
     void logStatistics()
     {
         if (_executionCount == 0) return;
@@ -123,27 +289,149 @@ private:
         double startJitter = _maxStartJitter - _minStartJitter;
 
         std::cout << "\n[Service] " << service_name << "\n";
-        std::cout << "Period: " << _period << " ms\n";
+        if (isEventDriven())
+            std::cout << "Event-driven, " << _executionCount << " releases\n";
+        else
+            std::cout << "Period: " << _period << " ms\n";
         std::cout << "  Min Exec Time: " << _minExecTime << " ms\n";
         std::cout << "  Max Exec Time: " << _maxExecTime << " ms\n";
         std::cout << "  Avg Exec Time: " << avgExecTime << " ms\n";
         std::cout << "  Exec Jitter  : " << execJitter << " ms\n";
-        std::cout << "  Start Jitter : " << startJitter << " ms\n";
+        if (!isEventDriven() && _minStartJitter <= _maxStartJitter)
+            std::cout << "  Start Jitter : " << startJitter << " ms\n";
+        std::cout << "  Deadline Misses: " << _deadlineMisses << " (" << _droppedReleases
+                  << " releases dropped, policy " << _policyName() << ")\n";
+        if (_releaseLatencyCount > 0)
+            std::cout << "  Release Latency (min/avg/max): " << _minReleaseLatency << " / "
+                      << _totalReleaseLatency / _releaseLatencyCount << " / " << _maxReleaseLatency << " ms\n";
+
+        HistogramSnapshot exec = _execHist.snapshot();
+        HistogramSnapshot rel = _releaseHist.snapshot();
+        std::cout << "  Exec Time p50/p99/p99.9      : " << exec.percentileMs(0.5) << " / "
+                  << exec.percentileMs(0.99) << " / " << exec.percentileMs(0.999) << " ms\n";
+        std::cout << "  Release Latency p50/p99/p99.9: " << rel.percentileMs(0.5) << " / "
+                  << rel.percentileMs(0.99) << " / " << rel.percentileMs(0.999) << " ms\n";
     }
 };
 
+// Releases a service once at an absolute CLOCK_MONOTONIC time, on top of
+// the releases it already gets (e.g. a capture at a predicted arrival).
+// Arming it again moves the pending release. The Sequencer's dispatcher
+// thread fires it from the same absolute-deadline sleep as the periodic
+// releases; at() and cancel() only set the deadline and wake the
+// dispatcher. Created through Sequencer::addScheduledRelease(), which
+// closes it before the services stop.
+class ScheduledRelease
+{
+public:
+    ScheduledRelease(Service& service, sem_t& wake) : _service(service), _wake(wake) {}
+
+    ScheduledRelease(const ScheduledRelease&) = delete;
+    ScheduledRelease& operator=(const ScheduledRelease&) = delete;
+
+    void at(uint64_t monotonicUs)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_closed) return;
+        _deadlineUs.store(monotonicUs);
+        sem_post(&_wake);
+    }
+
+    void cancel()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_closed) return;
+        _deadlineUs.store(0);
+        sem_post(&_wake);
+    }
+
+    // Later at() and cancel() calls do nothing
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _deadlineUs.store(0);
+    }
+
+private:
+    friend class Sequencer;
+
+    Service& _service;
+    sem_t& _wake;
+    std::atomic<uint64_t> _deadlineUs{0};   // 0 = not armed
+    bool _closed = false;
+    std::mutex _mutex;
+
+    // Dispatcher side: releases the service unless it was re-armed or
+    // cancelled since the dispatcher read this deadline
+    void _fire(uint64_t deadlineUs)
+    {
+        if (_deadlineUs.compare_exchange_strong(deadlineUs, 0)) _service.releaseExtra();
+    }
+};
+
+// How periodic services are released:
+//  - Dispatcher: one pinned SCHED_FIFO thread sleeping on absolute
+//    CLOCK_MONOTONIC deadlines from a precomputed hyperperiod table.
+//  - PosixTimers: one CLOCK_REALTIME SIGEV_THREAD timer per service
+//    (the original scheme, kept for start-jitter comparisons).
+// Scheduled releases always go through the dispatcher thread, which in
+// PosixTimers mode runs with an empty table just for them.
+enum class ReleaseMode { Dispatcher, PosixTimers };
+
 class Sequencer
 {
 public:
+    Sequencer(ReleaseMode mode = ReleaseMode::Dispatcher, uint8_t dispatcherAffinity = 0,
+              uint8_t dispatcherPriority = 99) :
+        _mode(mode), _dispatcherAffinity(dispatcherAffinity), _dispatcherPriority(dispatcherPriority)
+    {
+        sem_init(&_dispatcherWake, 0, 0);
+    }
+
+    ~Sequencer()
+    {
+        sem_destroy(&_dispatcherWake);
+    }
+
+    Sequencer(const Sequencer&) = delete;
+    Sequencer& operator=(const Sequencer&) = delete;
+
     template<typename... Args>
-    void addService(Args&&... args)
+    Service& addService(Args&&... args)
     {
         _services.emplace_back(std::make_unique<Service>(std::forward<Args>(args)...));
+        return *_services.back();
+    }
+
+    // Released by a producer calling Service::release() instead of a timer
+    template<typename T>
+    Service& addEventService(std::string name, T&& doService, uint8_t affinity, uint8_t priority,
+                             OverrunPolicy policy = OverrunPolicy::Queue, uint32_t queueBound = 0)
+    {
+        return addService(std::move(name), std::forward<T>(doService), affinity, priority, 0, policy, queueBound);
+    }
+
+    // One-off releases for a service on top of its own, see ScheduledRelease.
+    // Add them before startServices().
+    ScheduledRelease& addScheduledRelease(Service& service)
+    {
+        _scheduledReleases.emplace_back(std::make_unique<ScheduledRelease>(service, _dispatcherWake));
+        return *_scheduledReleases.back();
     }
 
     void startServices()
     {
+        if (_mode == ReleaseMode::Dispatcher) _buildReleaseTable();
+        if (_mode == ReleaseMode::Dispatcher || !_scheduledReleases.empty()) {
+            _dispatching = true;
+            _dispatcher = std::jthread(&Sequencer::_dispatch, this);
+        }
+        if (_mode == ReleaseMode::Dispatcher) return;
+
         for (auto& svc : _services) {
+            if (svc->isEventDriven()) continue;
+
             timer_t timerId;
             struct sigevent sev{};
             sev.sigev_notify = SIGEV_THREAD;
@@ -174,13 +462,60 @@ public:
         }
     }
 
+    std::vector<ServiceSnapshot> snapshot() const
+    {
+        std::vector<ServiceSnapshot> snaps;
+        for (auto& svc : _services) snaps.push_back(svc->snapshot());
+        return snaps;
+    }
+
+    // One JSON object per service and line, for periodic dumps while running
+    void dumpStatistics(std::ostream& out) const
+    {
+        auto now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+        auto hist = [&out](const char* key, const HistogramSnapshot& h) {
+            out << "\"" << key << "\":";
+            writeJson(out, h);
+        };
+        for (auto& snap : snapshot()) {
+            out << std::fixed << "{\"time\":" << now << ",\"service\":\"" << snap.name
+                << "\",\"period_ms\":" << snap.period << ",\"deadline_misses\":" << snap.deadlineMisses
+                << ",\"dropped_releases\":" << snap.droppedReleases << ",";
+            hist("exec", snap.execTime);
+            out << ",";
+            hist("release_latency", snap.releaseLatency);
+            out << "}\n";
+        }
+        out << std::defaultfloat;
+        out.flush();
+    }
+
     void stopServices()
     {
+        for (auto& scheduled : _scheduledReleases) {
+            scheduled->close();
+        }
+        if (_dispatching) {
+            _dispatching = false;
+            sem_post(&_dispatcherWake);
+            _dispatcher.join();
+            _logDispatcherStatistics();
+        }
+
         for (auto& timer : _timerIds) {
             timer_delete(timer);
         }
         _timerIds.clear();
 
+        // Services release each other, so none may lose its semaphore while
+        // another one's worker can still run: stop them all taking releases,
+        // then join every worker, and only then free anything
+        for (auto& svc : _services) {
+            svc->beginStop();
+        }
+        for (auto& svc : _services) {
+            svc->join();
+        }
         for (auto& svc : _services) {
             svc->stop();
         }
@@ -189,4 +524,164 @@ public:
 private:
     std::vector<std::unique_ptr<Service>> _services;
     std::vector<timer_t> _timerIds;
+    std::vector<std::unique_ptr<ScheduledRelease>> _scheduledReleases;
+
+    ReleaseMode _mode;
+    uint8_t _dispatcherAffinity;
+    uint8_t _dispatcherPriority;
+    std::jthread _dispatcher;
+    std::atomic<bool> _dispatching{false};
+    // Posted when a scheduled release is re-armed or the dispatcher has to stop
+    sem_t _dispatcherWake;
+
+    // Release points within one hyperperiod, sorted by offset
+    struct ReleasePoint {
+        uint64_t offsetMs;
+        std::vector<Service*> services;
+    };
+    std::vector<ReleasePoint> _releaseTable;
+    uint64_t _hyperperiodMs = 0;
+
+    // How late the dispatcher wakes up relative to its absolute deadline
+    double _minWakeLatency = std::numeric_limits<double>::max();
+    double _maxWakeLatency = 0.0;
+    double _totalWakeLatency = 0.0;
+    uint64_t _wakeCount = 0;
+
+    // Same, for the scheduled releases
+    double _maxScheduledLatency = 0.0;
+    double _totalScheduledLatency = 0.0;
+    uint64_t _scheduledCount = 0;
+
+    void _buildReleaseTable()
+    {
+        _releaseTable.clear();
+        _hyperperiodMs = 1;
+        for (auto& svc : _services) {
+            if (!svc->isEventDriven()) _hyperperiodMs = std::lcm(_hyperperiodMs, uint64_t(svc->getPeriod()));
+        }
+
+        // Same phasing as the timers: first release one period after start
+        std::map<uint64_t, std::vector<Service*>> points;
+        for (auto& svc : _services) {
+            if (svc->isEventDriven()) continue;
+            for (uint64_t t = svc->getPeriod(); t <= _hyperperiodMs; t += svc->getPeriod())
+                points[t].push_back(svc.get());
+        }
+        for (auto& [offset, services] : points)
+            _releaseTable.push_back({offset, std::move(services)});
+    }
+
+    static void _addMs(timespec& ts, uint64_t ms)
+    {
+        ts.tv_sec += ms / 1000;
+        ts.tv_nsec += (ms % 1000) * 1'000'000;
+        if (ts.tv_nsec >= 1'000'000'000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1'000'000'000;
+        }
+    }
+
+    static double _msLate(const timespec& deadline)
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (now.tv_sec - deadline.tv_sec) * 1e3 + (now.tv_nsec - deadline.tv_nsec) / 1e6;
+    }
+
+    // Sleeps until an absolute deadline (none = until woken), firing the
+    // scheduled releases that fall due first. False once stopping.
+    bool _sleepUntil(const timespec* deadline)
+    {
+        while (true) {
+            ScheduledRelease* first = nullptr;
+            uint64_t firstUs = 0;
+            for (auto& scheduled : _scheduledReleases) {
+                uint64_t us = scheduled->_deadlineUs.load();
+                if (us && (!first || us < firstUs)) {
+                    first = scheduled.get();
+                    firstUs = us;
+                }
+            }
+
+            const timespec* until = deadline;
+            timespec scheduledAt;
+            if (first) {
+                scheduledAt.tv_sec = firstUs / 1'000'000;
+                scheduledAt.tv_nsec = (firstUs % 1'000'000) * 1000;
+                if (!deadline || scheduledAt.tv_sec < deadline->tv_sec
+                    || (scheduledAt.tv_sec == deadline->tv_sec && scheduledAt.tv_nsec < deadline->tv_nsec))
+                    until = &scheduledAt;
+                else
+                    first = nullptr;
+            }
+
+            // A post means a scheduled release moved (or stop): look again
+            int rc = until ? sem_clockwait(&_dispatcherWake, CLOCK_MONOTONIC, until) : sem_wait(&_dispatcherWake);
+            if (!_dispatching) return false;
+            if (rc == 0 || errno != ETIMEDOUT) continue;
+            if (!first) return true;
+
+            double late = _msLate(scheduledAt);
+            _maxScheduledLatency = std::max(_maxScheduledLatency, late);
+            _totalScheduledLatency += late;
+            _scheduledCount++;
+            first->_fire(firstUs);
+        }
+    }
+
+    void _dispatch()
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(_dispatcherAffinity, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0) {
+            perror("Failed to set dispatcher CPU affinity");
+        }
+
+        sched_param sch_params;
+        sch_params.sched_priority = _dispatcherPriority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch_params) != 0) {
+            perror("Failed to set dispatcher SCHED_FIFO priority");
+        }
+
+        // Without a table (PosixTimers mode) only scheduled releases are served
+        if (_releaseTable.empty()) {
+            _sleepUntil(nullptr);
+            return;
+        }
+
+        timespec cycleStart;
+        clock_gettime(CLOCK_MONOTONIC, &cycleStart);
+
+        while (_dispatching) {
+            for (auto& point : _releaseTable) {
+                timespec deadline = cycleStart;
+                _addMs(deadline, point.offsetMs);
+                if (!_sleepUntil(&deadline)) return;
+
+                double late = _msLate(deadline);
+                _minWakeLatency = std::min(_minWakeLatency, late);
+                _maxWakeLatency = std::max(_maxWakeLatency, late);
+                _totalWakeLatency += late;
+                _wakeCount++;
+
+                for (Service* svc : point.services) svc->release();
+            }
+            _addMs(cycleStart, _hyperperiodMs);
+        }
+    }
+
+    void _logDispatcherStatistics()
+    {
+        if (_wakeCount == 0 && _scheduledCount == 0) return;
+        std::cout << "\n[Dispatcher] hyperperiod " << _hyperperiodMs << " ms, "
+                  << _releaseTable.size() << " release points\n";
+        if (_wakeCount > 0)
+            std::cout << "  Wakeup Latency (min/avg/max): " << _minWakeLatency << " / "
+                      << _totalWakeLatency / _wakeCount << " / " << _maxWakeLatency << " ms\n";
+        if (_scheduledCount > 0)
+            std::cout << "  Scheduled releases: " << _scheduledCount << ", wakeup latency (avg/max): "
+                      << _totalScheduledLatency / _scheduledCount << " / " << _maxScheduledLatency << " ms\n";
+    }
 };
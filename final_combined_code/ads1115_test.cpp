@@ -0,0 +1,138 @@
+// Runs ADS1115rpi against MockAds1115 with a fake data-ready line: prints
+// the I2C syscalls and CPU time per sample of each read path, and checks
+// that scan mode rotates AIN0 -> AIN3 and hands every sample to the
+// channel it was converted from. Built and run by make test.
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <gpiod.h>
+#include "ads1115rpi.h"
+
+// The data-ready line, faked: every wait is an edge, after the mock has
+// finished a conversion for whatever the multiplexer is set to
+static MockAds1115* mock = nullptr;
+
+extern "C" {
+struct gpiod_chip* gpiod_chip_open_by_number(unsigned) { return reinterpret_cast<gpiod_chip*>(&mock); }
+struct gpiod_line* gpiod_chip_get_line(struct gpiod_chip*, unsigned) { return reinterpret_cast<gpiod_line*>(&mock); }
+int gpiod_line_request_rising_edge_events(struct gpiod_line*, const char*) { return 0; }
+void gpiod_line_release(struct gpiod_line*) {}
+void gpiod_chip_close(struct gpiod_chip*) {}
+
+int gpiod_line_event_wait(struct gpiod_line*, const struct timespec*)
+{
+    mock->convert();
+    return 1;
+}
+
+int gpiod_line_event_read(struct gpiod_line*, struct gpiod_line_event* event)
+{
+    clock_gettime(CLOCK_MONOTONIC, &event->ts);
+    event->event_type = GPIOD_LINE_EVENT_RISING_EDGE;
+    return 0;
+}
+}
+
+static const uint64_t SAMPLES = 2000;
+
+// Raw conversion result per input, so a sample tells which input it came from
+static int16_t raw_for(unsigned input) { return static_cast<int16_t>(0x1000 * (input + 1)); }
+static float volts_for(unsigned input) { return raw_for(input) / float(0x7fff) * 2.048f; }
+
+// Counts syscalls and time from the first sample to the SAMPLES-th, so
+// the setup writes at start() are left out
+struct Meter : ADS1115rpi::ADSCallbackInterface {
+    ADS1115rpi& ads;
+    uint64_t samples = 0;
+    uint64_t first_syscalls = 0, last_syscalls = 0;
+    std::chrono::steady_clock::time_point first_time, last_time;
+    std::vector<ADS1115settings::Input> channels;
+    std::vector<float> volts;
+
+    explicit Meter(ADS1115rpi& ads) : ads(ads) {}
+
+    void hasADS1115Sample(float sample) override { record(ADS1115settings::AIN0, sample); }
+    void hasADS1115ChannelSample(ADS1115settings::Input channel, float sample) override { record(channel, sample); }
+
+    void record(ADS1115settings::Input channel, float sample) {
+        if (++samples > SAMPLES) return;
+        channels.push_back(channel);
+        volts.push_back(sample);
+        if (samples == 1) {
+            first_syscalls = ads.getI2cSyscalls();
+            first_time = std::chrono::steady_clock::now();
+        } else if (samples == SAMPLES) {
+            last_syscalls = ads.getI2cSyscalls();
+            last_time = std::chrono::steady_clock::now();
+        }
+    }
+
+    double syscallsPerSample() const { return double(last_syscalls - first_syscalls) / (SAMPLES - 1); }
+    double usPerSample() const {
+        return std::chrono::duration<double, std::micro>(last_time - first_time).count() / (SAMPLES - 1);
+    }
+};
+
+static Meter run(ADS1115rpi& ads, ADS1115settings settings)
+{
+    auto transport = std::make_unique<MockAds1115>(raw_for);
+    mock = transport.get();
+    ads.setTransport(std::move(transport));
+
+    Meter meter(ads);
+    ads.registerCallback(&meter);
+    ads.start(settings);
+    while (ads.getSampleCount() < SAMPLES) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ads.stop();
+    return meter;
+}
+
+static bool read_path(const char* name, bool combined, bool continuous, double expected_syscalls)
+{
+    ADS1115rpi ads;
+    ADS1115settings settings;
+    settings.combinedTransfers = combined;
+    settings.continuousReads = continuous;
+    settings.channel = ADS1115settings::AIN2;
+    const Meter meter = run(ads, settings);
+
+    bool ok = meter.syscallsPerSample() == expected_syscalls;
+    for (float v : meter.volts) ok &= std::abs(v - volts_for(ADS1115settings::AIN2)) < 1e-6f;
+    std::cout << (ok ? "ok   " : "FAIL ") << name << ": " << meter.syscallsPerSample() << " syscalls, "
+              << meter.usPerSample() << " us per sample\n";
+    return ok;
+}
+
+static bool scan()
+{
+    ADS1115rpi ads;
+    ADS1115settings settings;
+    settings.scanSequence = {ADS1115settings::AIN0, ADS1115settings::AIN1, ADS1115settings::AIN2, ADS1115settings::AIN3};
+    const Meter meter = run(ads, settings);
+
+    // Start the next conversion, then read this one: a config write and a combined read
+    bool ok = meter.syscallsPerSample() == 2.0;
+    size_t misplaced = 0;
+    for (size_t i = 0; i < meter.channels.size(); ++i) {
+        const unsigned expected = i % 4;
+        if (meter.channels[i] != expected || std::abs(meter.volts[i] - volts_for(expected)) >= 1e-6f) misplaced++;
+    }
+    ok &= misplaced == 0;
+    std::cout << (ok ? "ok   " : "FAIL ") << "scan AIN0-AIN3: " << meter.syscallsPerSample() << " syscalls, "
+              << meter.usPerSample() << " us per sample, " << misplaced << " of " << meter.channels.size()
+              << " samples out of order or on the wrong channel\n";
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    ok &= read_path("write + read (old)      ", false, false, 2.0);
+    ok &= read_path("combined I2C_RDWR       ", true, false, 1.0);
+    ok &= read_path("pointer left, plain read", true, true, 1.0);
+    ok &= scan();
+    return ok ? 0 : 1;
+}
@@ -9,24 +9,28 @@
 void ADS1115rpi::start(ADS1115settings settings) {
 	ads1115settings = settings;
 
-	char gpioFilename[20];
-	snprintf(gpioFilename, 19, "/dev/i2c-%d", settings.i2c_bus);
-	fd_i2c = open(gpioFilename, O_RDWR);
-	if (fd_i2c < 0) {
-	    char i2copen[] = "Could not open I2C.\n";
+	if (!transport) {
+	    char gpioFilename[20];
+	    snprintf(gpioFilename, 19, "/dev/i2c-%d", settings.i2c_bus);
+	    fd_i2c = open(gpioFilename, O_RDWR);
+	    if (fd_i2c < 0) {
+		char i2copen[] = "Could not open I2C.\n";
 #ifdef DEBUG
-	    fprintf(stderr,i2copen);
+		fprintf(stderr,i2copen);
 #endif
-	    throw i2copen;
-	}
-	
-	if (ioctl(fd_i2c, I2C_SLAVE, settings.address) < 0) {
-	    char i2cslave[] = "Could not access I2C adress.\n";
+		throw i2copen;
+	    }
+
+	    if (ioctl(fd_i2c, I2C_SLAVE, settings.address) < 0) {
+		char i2cslave[] = "Could not access I2C adress.\n";
 #ifdef DEBUG
-	    fprintf(stderr,i2cslave);
+		fprintf(stderr,i2cslave);
 #endif
-	    throw i2cslave;
+		throw i2cslave;
+	    }
+	    transport = std::make_unique<LinuxI2cTransport>(fd_i2c, settings.address);
 	}
+	pointerReg = -1;
 	
 #ifdef DEBUG
 	fprintf(stderr,"Init.\n");
@@ -39,8 +43,13 @@ void ADS1115rpi::start(ADS1115settings settings) {
 	r = r | (1 << 2) | (1 << 3); // data ready active high & latching
 	r = r | (settings.samplingRate << 5);
 	r = r | (settings.pgaGain << 9);
-	r = r | (settings.channel << 12) | 1 << 14; // unipolar
-	i2c_writeWord(reg_config,r);
+	configWord = r | muxBits(settings.channel);
+
+	scanConfig.clear();
+	scanIndex = 0;
+	for(auto channel: settings.scanSequence) {
+	    scanConfig.push_back(r | muxBits(channel) | (1 << 8)); // single shot
+	}
 
 #ifdef DEBUG
 	fprintf(stderr,"Receiving data.\n");
@@ -57,6 +66,9 @@ void ADS1115rpi::start(ADS1115settings settings) {
 	    throw "Could not request event for IRQ.";
 	}
 
+	// only now, so that the first conversion's edge can't be missed
+	i2c_writeWord(reg_config, scanConfig.empty() ? configWord : scanConfig[0]);
+
 	running = true;
 
 	thr = std::thread(&ADS1115rpi::worker,this);
@@ -64,29 +76,53 @@ void ADS1115rpi::start(ADS1115settings settings) {
 
 
 void ADS1115rpi::setChannel(ADS1115settings::Input channel) {
-	unsigned r = i2c_readWord(reg_config);
-	r = r & (~(3 << 12));
-	r = r | (channel << 12);
-	i2c_writeWord(reg_config,r);
+	if (!scanConfig.empty()) return; // the scan sequence owns the multiplexer
+	configWord = (configWord & ~(3 << 12)) | muxBits(channel);
+	i2c_writeWord(reg_config,configWord);
 	ads1115settings.channel = channel;	
 }
 
 
-void ADS1115rpi::dataReady() {
+void ADS1115rpi::dataReady(uint64_t timestamp_us) {
+	if (!scanConfig.empty()) {
+	    scanReady(timestamp_us);
+	    return;
+	}
 	float v = (float)i2c_readConversion() / (float)0x7fff * fullScaleVoltage();
+	sampleCount++;
+	if (sampleRing) sampleRing->push({timestamp_us, v});
 	for(auto &cb: adsCallbackInterfaces) {
 	    cb->hasADS1115Sample(v);
 	}
 }
 
 
+void ADS1115rpi::scanReady(uint64_t timestamp_us) {
+	const ADS1115settings::Input channel = ads1115settings.scanSequence[scanIndex];
+	scanIndex = (scanIndex + 1) % scanConfig.size();
+	// Start the next conversion first: the conversion register keeps
+	// this result until it's done, so the read overlaps the conversion.
+	i2c_writeWord(reg_config, scanConfig[scanIndex]);
+	float v = (float)i2c_readConversion() / (float)0x7fff * fullScaleVoltage();
+	sampleCount++;
+	if (channelRings[channel]) channelRings[channel]->push({timestamp_us, v});
+	for(auto &cb: adsCallbackInterfaces) {
+	    cb->hasADS1115ChannelSample(channel, v);
+	}
+}
+
+
 void ADS1115rpi::worker() {
     while (running) {
 	const struct timespec ts = { 1, 0 };
-	gpiod_line_event_wait(pinDRDY, &ts);
+	if (gpiod_line_event_wait(pinDRDY, &ts) <= 0) {
+	    // a lost edge would stall single-shot conversions for good
+	    if (running && !scanConfig.empty()) i2c_writeWord(reg_config, scanConfig[scanIndex]);
+	    continue;
+	}
 	struct gpiod_line_event event;
 	gpiod_line_event_read(pinDRDY, &event);
-	dataReady();
+	dataReady(event.ts.tv_sec * 1000000ULL + event.ts.tv_nsec / 1000);
     }
 }
 
@@ -97,7 +133,11 @@ void ADS1115rpi::stop() {
     thr.join();
     gpiod_line_release(pinDRDY);
     gpiod_chip_close(chipDRDY);
-    close(fd_i2c);
+    if (fd_i2c >= 0) {
+	transport.reset();
+	close(fd_i2c);
+	fd_i2c = -1;
+    }
 }
 
 
@@ -108,42 +148,49 @@ void ADS1115rpi::i2c_writeWord(uint8_t reg, unsigned data)
 	tmp[0] = reg;
 	tmp[1] = (char)((data & 0xff00) >> 8);
 	tmp[2] = (char)(data & 0x00ff);
-	long int r = write(fd_i2c,&tmp,3);
-        if (r < 0) {
+	pointerReg = reg;
+        if (!transport->write(tmp,3)) {
+		pointerReg = -1;
 #ifdef DEBUG
-                fprintf(stderr,"Could not write word from %02x. ret=%d.\n",ads1115settings.address,r);
+                fprintf(stderr,"Could not write word from %02x.\n",ads1115settings.address);
 #endif
                 throw "Could not write to i2c.";
         }
 }
 
-unsigned ADS1115rpi::i2c_readWord(uint8_t reg)
+// 2 bytes from reg: a plain read if the pointer is already there,
+// otherwise the pointer write and the read as one or two transactions
+void ADS1115rpi::i2c_readRegister(uint8_t reg, uint8_t* buffer)
 {
-	uint8_t tmp[2];
-	tmp[0] = reg;
-	write(fd_i2c,&tmp,1);
-        long int r = read(fd_i2c, tmp, 2);
-        if (r < 0) {
+	bool ok;
+	if (ads1115settings.continuousReads && pointerReg == reg) {
+	    ok = transport->read(buffer, 2);
+	} else if (ads1115settings.combinedTransfers) {
+	    ok = transport->writeRead(&reg, 1, buffer, 2);
+	} else {
+	    transport->write(&reg, 1);
+	    ok = transport->read(buffer, 2);
+	}
+	pointerReg = reg;
+        if (!ok) {
+		pointerReg = -1;
 #ifdef DEBUG
-                fprintf(stderr,"Could not read word from %02x. ret=%d.\n",ads1115settings.address,r);
+                fprintf(stderr,"Could not read register %d from %02x.\n",reg,ads1115settings.address);
 #endif
                 throw "Could not read from i2c.";
         }
+}
+
+unsigned ADS1115rpi::i2c_readWord(uint8_t reg)
+{
+	uint8_t tmp[2];
+	i2c_readRegister(reg, tmp);
         return (((unsigned)(tmp[0])) << 8) | ((unsigned)(tmp[1]));
 }
 
 int ADS1115rpi::i2c_readConversion()
 {
-	const int reg = 0;
-	char tmp[3];
-	tmp[0] = reg;
-	write(fd_i2c,&tmp,1);
-        long int r = read(fd_i2c, tmp, 2);
-        if (r < 0) {
-#ifdef DEBUG
-                fprintf(stderr,"Could not read ADC value. ret=%d.\n",r);
-#endif
-                throw "Could not read from i2c.";
-        }
+	uint8_t tmp[2];
+	i2c_readRegister(reg_conversion, tmp);
         return ((int)(tmp[0]) << 8) | (int)(tmp[1]);
 }
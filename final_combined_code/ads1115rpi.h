@@ -22,6 +22,10 @@
 #include <thread>
 #include <gpiod.h>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include "i2c_transport.hpp"
+#include "sample_ring.hpp"
 
 // enable debug messages and error messages to stderr
 #ifndef NDEBUG
@@ -114,6 +118,15 @@ struct ADS1115settings {
      **/
     Input channel = AIN0;
 
+    /**
+     * Channels to cycle through, e.g. {AIN0, AIN1, AIN0, AIN2}.
+     * Empty: continuous conversions of "channel" only. Otherwise
+     * the chip runs single-shot conversions, the next one started
+     * as soon as the previous one is ready, and each channel gets
+     * its share of the sampling rate.
+     **/
+    std::vector<Input> scanSequence;
+
     /**
      * GPIO Chip number which receives the Data Ready signal.
      * For RPI 1-4 it's chip 0. For the RPI5 it's chip number 4.
@@ -124,6 +137,20 @@ struct ADS1115settings {
      * GPIO pin connected to ALERT/RDY
      **/
     int drdy_gpio = DEFAULT_ALERT_RDY_TO_GPIO;
+
+    /**
+     * Read registers with one combined I2C_RDWR transaction
+     * (pointer write, repeated start, 2-byte read) instead of
+     * a write() followed by a read().
+     **/
+    bool combinedTransfers = true;
+
+    /**
+     * Leave the pointer register at the conversion register
+     * so that every sample is a single 2-byte read. The pointer
+     * is only written again after a config access.
+     **/
+    bool continuousReads = true;
 };
 
 
@@ -150,17 +177,70 @@ public:
 	     * \param sample Voltage from the selected channel.
 	     **/
 	virtual void hasADS1115Sample(float sample) = 0;
+
+	    /**
+	     * Called instead in scan mode, with the channel
+	     * the sample is from. By default it forwards to
+	     * hasADS1115Sample().
+	     * \param channel Channel the sample was converted from.
+	     * \param sample Voltage from that channel.
+	     **/
+	virtual void hasADS1115ChannelSample(ADS1115settings::Input channel, float sample) {
+	    (void)channel;
+	    hasADS1115Sample(sample);
+	}
     };
 
     void registerCallback(ADSCallbackInterface* ci) {
 	adsCallbackInterfaces.push_back(ci);
     }
 
+    /**
+     * Pushes every sample, stamped with the kernel timestamp
+     * of its data-ready interrupt, into a lock-free ring
+     * instead of (or as well as) calling the callbacks.
+     * Set before start().
+     **/
+    void setSampleRing(SampleRing* ring) {
+	sampleRing = ring;
+    }
+
+    /**
+     * Ring for the samples of one channel in scan mode.
+     * Channels without a ring only go to the callbacks.
+     * Set before start().
+     **/
+    void setSampleRing(ADS1115settings::Input channel, SampleRing* ring) {
+	channelRings[channel] = ring;
+    }
+
+    /**
+     * Talks to the chip through this transport instead of
+     * /dev/i2c-N, e.g. a MockAds1115. Set before start().
+     **/
+    void setTransport(std::unique_ptr<I2cTransport> t) {
+	transport = std::move(t);
+    }
+
+    /**
+     * Number of samples read so far
+     **/
+    uint64_t getSampleCount() const {
+	return sampleCount;
+    }
+
+    /**
+     * Number of I2C syscalls made so far (config writes included)
+     **/
+    uint64_t getI2cSyscalls() const {
+	return transport ? transport->syscalls() : 0;
+    }
+
     /**
      * Selects a different channel at the multiplexer
-     * while running.
-     * Call this in the callback handler hasSample()
-     * to cycle through different channels.
+     * while running. For cycling through channels
+     * set ADS1115settings::scanSequence instead.
+     * Ignored in scan mode.
      * \param channel Sets the channel from A0..A3.
      **/
     void setChannel(ADS1115settings::Input channel);
@@ -187,14 +267,21 @@ public:
 private:
     ADS1115settings ads1115settings;
 
-    void dataReady();
+    void dataReady(uint64_t timestamp_us);
+    void scanReady(uint64_t timestamp_us);
 
     void worker();
 
     void i2c_writeWord(uint8_t reg, unsigned data);
     unsigned i2c_readWord(uint8_t reg);
     int i2c_readConversion();
+    void i2c_readRegister(uint8_t reg, uint8_t* buffer);
+
+    static unsigned muxBits(ADS1115settings::Input channel) {
+	return (channel << 12) | 1 << 14; // unipolar
+    }
 
+    const uint8_t reg_conversion = 0;
     const uint8_t reg_config = 1;
     const uint8_t reg_lo_thres = 2;
     const uint8_t reg_hi_thres = 3;
@@ -221,9 +308,27 @@ private:
 
     int fd_i2c = -1;
 
+    std::unique_ptr<I2cTransport> transport;
+
+    // where the chip's pointer register was left, -1 = unknown
+    int pointerReg = -1;
+
+    std::atomic<uint64_t> sampleCount{0};
+
+    // config register as last written, so it never has to be read back
+    unsigned configWord = 0;
+
+    // scan mode: one config word per step, starting a single-shot conversion
+    std::vector<unsigned> scanConfig;
+    size_t scanIndex = 0;
+
+    SampleRing* channelRings[4] = {};
+
     bool running = false;
 
     std::vector<ADSCallbackInterface*> adsCallbackInterfaces;
+
+    SampleRing* sampleRing = nullptr;
 };
 
 
@@ -0,0 +1,70 @@
+#include "approach_predictor.hpp"
+#include <algorithm>
+#include <cmath>
+
+ApproachPredictor::ApproachPredictor(ApproachSettings settings) : settings(settings)
+{
+}
+
+void ApproachPredictor::add(uint64_t timestamp_us, float cm)
+{
+    if (!std::isfinite(cm) || (!readings.empty() && cm > readings.back().cm + settings.jump_cm))
+        readings.clear();
+    if (!std::isfinite(cm)) return;
+
+    readings.push_back({timestamp_us, cm});
+    const uint64_t window_us = static_cast<uint64_t>(settings.window_ms * 1000.0);
+    while (readings.size() > settings.history || readings.front().timestamp_us + window_us < timestamp_us)
+        readings.pop_front();
+}
+
+uint64_t ApproachPredictor::predict()
+{
+    predicted_us = 0;
+    if (readings.size() < std::max<size_t>(settings.min_readings, 2)) return 0;
+
+    // Least squares on times relative to the newest reading, in seconds
+    const uint64_t newest_us = readings.back().timestamp_us;
+    double mean_t = 0.0, mean_d = 0.0;
+    for (const Reading& r : readings) {
+        mean_t += (static_cast<double>(r.timestamp_us) - newest_us) / 1e6;
+        mean_d += r.cm;
+    }
+    mean_t /= readings.size();
+    mean_d /= readings.size();
+    double s_tt = 0.0, s_td = 0.0;
+    for (const Reading& r : readings) {
+        const double t = (static_cast<double>(r.timestamp_us) - newest_us) / 1e6 - mean_t;
+        s_tt += t * t;
+        s_td += t * (r.cm - mean_d);
+    }
+    if (s_tt <= 0.0) return 0;
+    const double slope = s_td / s_tt;  // cm/s, negative while approaching
+    const double now_cm = mean_d - slope * mean_t;  // the fitted line at the newest reading
+    if (-slope < settings.min_speed || now_cm <= settings.target_cm) return 0;
+
+    predicted_speed = static_cast<float>(-slope);
+    predicted_us = newest_us + static_cast<uint64_t>((now_cm - settings.target_cm) / -slope * 1e6);
+    prediction_count.fetch_add(1, std::memory_order_relaxed);
+    return predicted_us;
+}
+
+double ApproachPredictor::score(uint64_t timestamp_us, float cm)
+{
+    const uint64_t predicted = predicted_us;
+    predicted_us = 0;
+    if (!predicted || !std::isfinite(cm) || predicted_speed <= 0.0f) return 0.0;
+
+    const double arrived_us = timestamp_us + (cm - settings.target_cm) / predicted_speed * 1e6;
+    const double error_ms = (arrived_us - static_cast<double>(predicted)) / 1000.0;
+    abs_error.record(std::abs(error_ms));
+    error_sum_ms.store(error_sum_ms.load(std::memory_order_relaxed) + error_ms, std::memory_order_relaxed);
+    scored_count.fetch_add(1, std::memory_order_relaxed);
+    return error_ms;
+}
+
+double ApproachPredictor::meanErrorMs() const
+{
+    const uint64_t n = scored();
+    return n ? error_sum_ms.load(std::memory_order_relaxed) / n : 0.0;
+}
@@ -0,0 +1,94 @@
+// approach_predictor.hpp
+#ifndef APPROACH_PREDICTOR_HPP
+#define APPROACH_PREDICTOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include "latency_histogram.hpp"
+
+struct ApproachSettings {
+    // Distance at which the object is in front of the camera, the capture threshold
+    float target_cm = 20.0f;
+
+    // Most recent readings fitted, and how old the oldest may be
+    size_t history = 3;
+    double window_ms = 1000.0;
+
+    // Readings needed before anything is predicted
+    size_t min_readings = 3;
+
+    // Closing slower than this (cm/s) is noise or a stopped belt, not an approach
+    float min_speed = 5.0f;
+
+    // A reading this much farther than the last starts over: the object left, or a new one came
+    float jump_cm = 5.0f;
+};
+
+/**
+ * Predicts when an approaching object reaches the imaging position
+ * from the last few ultrasonic readings. A least-squares line through
+ * (time, distance) gives the closing speed and a smoothed current
+ * distance; extrapolating it to target_cm gives the arrival time, so
+ * the capture can be taken at that instant instead of at the first
+ * capture period after it.
+ *
+ * Each prediction stays pending until it is scored against a reading
+ * taken around the predicted instant: the reading, extrapolated to
+ * target_cm at the predicted speed, estimates when the object really
+ * arrived, and the difference is the prediction error. Everything but
+ * the statistics belongs to the capture thread.
+ **/
+class ApproachPredictor {
+public:
+    explicit ApproachPredictor(ApproachSettings settings = ApproachSettings());
+
+    // A reading with its timestamp; one without an echo clears the history
+    void add(uint64_t timestamp_us, float cm);
+
+    // Arrival time from the readings so far, which becomes the pending
+    // prediction; 0 (and nothing pending) if no approach is under way or
+    // the object is already there
+    uint64_t predict();
+
+    // The prediction waiting to be scored, 0 if none
+    uint64_t pending() const { return predicted_us; }
+
+    // Closing speed of the pending prediction, cm/s
+    float speed() const { return predicted_speed; }
+
+    // Scores and clears the pending prediction against a reading taken
+    // around it. Returns the error in ms, positive if the object arrived
+    // later than predicted; 0 if the reading can't be scored (no echo).
+    double score(uint64_t timestamp_us, float cm);
+
+    void cancel() { predicted_us = 0; }
+
+    uint64_t predictions() const { return prediction_count.load(std::memory_order_relaxed); }
+    uint64_t scored() const { return scored_count.load(std::memory_order_relaxed); }
+
+    // |error| of the scored predictions
+    HistogramSnapshot error() const { return abs_error.snapshot(); }
+
+    // Mean signed error, ms; shows a bias (e.g. a sensor offset) that |error| hides
+    double meanErrorMs() const;
+
+private:
+    struct Reading {
+        uint64_t timestamp_us;
+        float cm;
+    };
+
+    const ApproachSettings settings;
+    std::deque<Reading> readings;
+    uint64_t predicted_us = 0;
+    float predicted_speed = 0.0f;
+
+    std::atomic<uint64_t> prediction_count{0};
+    std::atomic<uint64_t> scored_count{0};
+    std::atomic<double> error_sum_ms{0.0};
+    LatencyHistogram abs_error;
+};
+
+#endif // APPROACH_PREDICTOR_HPP
@@ -0,0 +1,166 @@
+#include "background_model.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Grid rows are capped near this, whatever the frame height
+static const int MAX_GRID_ROWS = 240;
+
+BackgroundModel::BackgroundModel(BackgroundSettings settings) : settings(settings)
+{
+}
+
+void BackgroundModel::configure(const Frame& frame)
+{
+    if (frame.width == frame_width && frame.height == frame_height) return;
+    frame_width = frame.width;
+    frame_height = frame.height;
+    row_step = std::max(1, (frame.height + MAX_GRID_ROWS - 1) / MAX_GRID_ROWS);
+    grid_width = frame.width / 2;
+    grid_height = frame.height / row_step;
+
+    const size_t cells = static_cast<size_t>(grid_width) * grid_height;
+    average.assign(cells, 0);
+    reference.assign(cells, 0);
+    current.assign(cells, 0);
+    column_count.assign(grid_width, 0);
+    row_count.assign(grid_height, 0);
+    learned = 0;
+}
+
+// current = Y0 of every pixel pair on every row_step-th row
+void BackgroundModel::sample(const Frame& frame)
+{
+    for (int r = 0; r < grid_height; ++r) {
+        const uint8_t* row = frame.yuyv() + static_cast<size_t>(r) * row_step * frame.stride();
+        uint8_t* dst = current.data() + static_cast<size_t>(r) * grid_width;
+        int x = 0;
+#if defined(__ARM_NEON)
+        for (; x + 16 <= grid_width; x += 16) vst1q_u8(dst + x, vld4q_u8(row + x * 4).val[0]);
+#elif defined(__SSE2__)
+        // Keep the low byte of each 4-byte pair, then narrow 4 x 4 dwords to 16 bytes
+        const __m128i lowmask = _mm_set1_epi32(0xff);
+        for (; x + 16 <= grid_width; x += 16) {
+            const __m128i* src = reinterpret_cast<const __m128i*>(row + x * 4);
+            __m128i a = _mm_and_si128(_mm_loadu_si128(src), lowmask);
+            __m128i b = _mm_and_si128(_mm_loadu_si128(src + 1), lowmask);
+            __m128i c = _mm_and_si128(_mm_loadu_si128(src + 2), lowmask);
+            __m128i d = _mm_and_si128(_mm_loadu_si128(src + 3), lowmask);
+            __m128i y = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), y);
+        }
+#endif
+        for (; x < grid_width; ++x) dst[x] = row[x * 4];
+    }
+}
+
+void BackgroundModel::learn(const Frame& frame)
+{
+    configure(frame);
+    sample(frame);
+
+    // average += (current - average) / 2^shift, in 8.8 fixed point
+    const int shift = std::clamp(settings.learn_shift, 0, 8);
+    const size_t cells = current.size();
+    if (learned == 0) {
+        for (size_t i = 0; i < cells; ++i) average[i] = static_cast<uint16_t>(current[i] << 8);
+        reference = current;
+    } else {
+        uint16_t* avg = average.data();
+        uint8_t* ref = reference.data();
+        const uint8_t* cur = current.data();
+        for (size_t i = 0; i < cells; ++i) {
+            const uint16_t v = static_cast<uint16_t>(avg[i] - (avg[i] >> shift) + (cur[i] << (8 - shift)));
+            avg[i] = v;
+            ref[i] = static_cast<uint8_t>((v + 128) >> 8);
+        }
+    }
+    if (learned < settings.warmup_frames) learned++;
+}
+
+Roi BackgroundModel::detect(const Frame& frame)
+{
+    if (!ready() || frame.width != frame_width || frame.height != frame_height) return frame.bounds();
+    sample(frame);
+
+    std::fill(column_count.begin(), column_count.end(), 0);
+    const int threshold = std::clamp(settings.threshold, 0, 254);
+    uint64_t total = 0;
+    for (int r = 0; r < grid_height; ++r) {
+        const uint8_t* a = current.data() + static_cast<size_t>(r) * grid_width;
+        const uint8_t* b = reference.data() + static_cast<size_t>(r) * grid_width;
+        uint16_t* col = column_count.data();
+        uint32_t count = 0;
+        int x = 0;
+#if defined(__ARM_NEON)
+        const uint8x16_t thr = vdupq_n_u8(static_cast<uint8_t>(threshold));
+        for (; x + 16 <= grid_width; x += 16) {
+            uint8x16_t fg = vshrq_n_u8(vcgtq_u8(vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x)), thr), 7);
+            count += vaddvq_u8(fg);
+            vst1q_u16(col + x, vaddw_u8(vld1q_u16(col + x), vget_low_u8(fg)));
+            vst1q_u16(col + x + 8, vaddw_u8(vld1q_u16(col + x + 8), vget_high_u8(fg)));
+        }
+#elif defined(__SSE2__)
+        // |a - b| from two saturating subtractions; foreground lanes become 0xff,
+        // which widened to 16 bits is -1, so subtracting counts them per column
+        const __m128i thr = _mm_set1_epi8(static_cast<char>(threshold));
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_cmpeq_epi8(zero, zero);
+        for (; x + 16 <= grid_width; x += 16) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+            __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            __m128i fg = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(diff, thr), zero), ones);
+            count += __builtin_popcount(_mm_movemask_epi8(fg));
+            __m128i* c = reinterpret_cast<__m128i*>(col + x);
+            _mm_storeu_si128(c, _mm_sub_epi16(_mm_loadu_si128(c), _mm_unpacklo_epi8(fg, fg)));
+            _mm_storeu_si128(c + 1, _mm_sub_epi16(_mm_loadu_si128(c + 1), _mm_unpackhi_epi8(fg, fg)));
+        }
+#endif
+        for (; x < grid_width; ++x) {
+            const bool fg = std::abs(a[x] - b[x]) > threshold;
+            count += fg;
+            col[x] += fg;
+        }
+        row_count[r] = static_cast<uint16_t>(count);
+        total += count;
+    }
+    if (total < settings.min_foreground * current.size()) return frame.bounds();
+
+    auto first = [this](const std::vector<uint16_t>& counts) {
+        for (size_t i = 0; i < counts.size(); ++i)
+            if (counts[i] >= settings.min_run) return static_cast<int>(i);
+        return -1;
+    };
+    auto last = [this](const std::vector<uint16_t>& counts) {
+        for (size_t i = counts.size(); i-- > 0;)
+            if (counts[i] >= settings.min_run) return static_cast<int>(i);
+        return -1;
+    };
+    const int c0 = first(column_count), c1 = last(column_count);
+    const int r0 = first(row_count), r1 = last(row_count);
+    if (c0 < 0 || r0 < 0) return frame.bounds();
+
+    // Grid box to pixels, plus the margin
+    float x0 = c0 * 2.0f, x1 = (c1 + 1) * 2.0f;
+    float y0 = static_cast<float>(r0 * row_step), y1 = static_cast<float>(std::min(frame.height, (r1 + 1) * row_step));
+    const float mx = (x1 - x0) * settings.margin, my = (y1 - y0) * settings.margin;
+    x0 -= mx;
+    x1 += mx;
+    y0 -= my;
+    y1 += my;
+
+    // Square around the centre so the resize keeps the object's shape, within the frame
+    const float side = std::max({x1 - x0, y1 - y0, settings.min_size * frame.height});
+    const int w = std::min(frame.width, static_cast<int>(std::ceil(side))) & ~1;
+    const int h = std::min(frame.height, static_cast<int>(std::ceil(side)));
+    const int x = std::clamp(static_cast<int>(std::lround((x0 + x1 - w) / 2)), 0, frame.width - w) & ~1;
+    const int y = std::clamp(static_cast<int>(std::lround((y0 + y1 - h) / 2)), 0, frame.height - h);
+    return {x, y, w, h};
+}
@@ -0,0 +1,71 @@
+// background_model.hpp
+#ifndef BACKGROUND_MODEL_HPP
+#define BACKGROUND_MODEL_HPP
+
+#include <cstdint>
+#include <vector>
+#include "frame.hpp"
+
+struct BackgroundSettings {
+    // Luma difference from the background that counts as foreground
+    int threshold = 25;
+
+    // Running average weight of each new frame, 1 / 2^learn_shift
+    int learn_shift = 3;
+
+    // Frames averaged in before detect() trusts the model
+    int warmup_frames = 8;
+
+    // Foreground cells a grid row or column needs to be part of the box, against noise
+    int min_run = 3;
+
+    // Less foreground than this fraction of the grid means nothing was found
+    float min_foreground = 0.005f;
+
+    // Box grown by this fraction of its size on each side, then made square where the frame allows
+    float margin = 0.1f;
+
+    // Crops never get smaller than this fraction of the frame height
+    float min_size = 0.25f;
+};
+
+/**
+ * Running-average model of the empty belt, on a grid of one luma
+ * sample per pixel pair every step-th row (320 x 240 for a 640 x 480
+ * frame). learn() folds in frames taken while nothing is under the
+ * sensor; detect() differences a frame against the model and returns
+ * the bounding box of what has changed, so only the object is resized
+ * into the model input instead of the whole view.
+ *
+ * The differencing, thresholding and per-row/column foreground counts
+ * are done with SSE2 or NEON. Both calls must come from one thread.
+ **/
+class BackgroundModel {
+public:
+    explicit BackgroundModel(BackgroundSettings settings = BackgroundSettings());
+
+    void learn(const Frame& frame);
+
+    // Region to classify; the whole frame if the model isn't ready or nothing stands out
+    Roi detect(const Frame& frame);
+
+    bool ready() const { return learned >= settings.warmup_frames; }
+    void reset() { learned = 0; }
+
+private:
+    const BackgroundSettings settings;
+    int grid_width = 0, grid_height = 0, row_step = 1;
+    int frame_width = 0, frame_height = 0;
+    int learned = 0;
+
+    std::vector<uint16_t> average;   // background luma, 8.8 fixed point
+    std::vector<uint8_t> reference;  // average rounded to 8 bits, what detect() compares against
+    std::vector<uint8_t> current;
+    std::vector<uint16_t> column_count;
+    std::vector<uint16_t> row_count;
+
+    void configure(const Frame& frame);
+    void sample(const Frame& frame);
+};
+
+#endif // BACKGROUND_MODEL_HPP
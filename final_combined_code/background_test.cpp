@@ -0,0 +1,202 @@
+// Checks BackgroundModel::detect(), whose sampling and foreground counts
+// are SSE2 or NEON, against a scalar model of the same steps: random
+// belts with a random object, at frame widths that leave the vector loops
+// a scalar tail, and a faint object exactly at the threshold. Built and
+// run by make test.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "background_model.hpp"
+
+static uint32_t seed = 1;
+
+static int noise(int range)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<int>((seed >> 16) % (2 * range + 1)) - range;
+}
+
+// Textured belt, plus sensor noise and optionally an object box
+static Frame make_frame(const std::vector<uint8_t>& belt, int width, int height, const Roi& object)
+{
+    Frame frame;
+    frame.width = width;
+    frame.height = height;
+    frame.data.resize(frame.stride() * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const bool inside = x >= object.x && x < object.x + object.width && y >= object.y && y < object.y + object.height;
+            const int luma = inside ? 200 + noise(40) : belt[static_cast<size_t>(y) * width + x] + noise(12);
+            frame.data[static_cast<size_t>(y) * frame.stride() + x * 2] = static_cast<uint8_t>(std::clamp(luma, 0, 255));
+            frame.data[static_cast<size_t>(y) * frame.stride() + x * 2 + 1] = static_cast<uint8_t>(128 + noise(20));
+        }
+    }
+    return frame;
+}
+
+// The same grid, running average and thresholding, one cell at a time.
+// The box arithmetic is scalar in both, so it is repeated as is.
+struct ScalarModel {
+    const BackgroundSettings s;
+    int row_step, grid_width, grid_height;
+    std::vector<uint16_t> average;
+    std::vector<uint8_t> reference;
+    int learned = 0;
+
+    ScalarModel(const BackgroundSettings& settings, int width, int height)
+        : s(settings), row_step(std::max(1, (height + 239) / 240)), grid_width(width / 2),
+          grid_height(height / row_step), average(static_cast<size_t>(grid_width) * grid_height),
+          reference(average.size())
+    {
+    }
+
+    uint8_t cell(const Frame& frame, int r, int c) const {
+        return frame.data[static_cast<size_t>(r) * row_step * frame.stride() + c * 4];
+    }
+
+    void learn(const Frame& frame) {
+        const int shift = std::clamp(s.learn_shift, 0, 8);
+        for (int r = 0; r < grid_height; ++r) {
+            for (int c = 0; c < grid_width; ++c) {
+                const size_t i = static_cast<size_t>(r) * grid_width + c;
+                const int y = cell(frame, r, c);
+                average[i] = learned ? static_cast<uint16_t>(average[i] - (average[i] >> shift) + (y << (8 - shift)))
+                                     : static_cast<uint16_t>(y << 8);
+                reference[i] = learned ? static_cast<uint8_t>((average[i] + 128) >> 8) : static_cast<uint8_t>(y);
+            }
+        }
+        learned++;
+    }
+
+    Roi detect(const Frame& frame) const {
+        std::vector<int> columns(grid_width), rows(grid_height);
+        size_t total = 0;
+        for (int r = 0; r < grid_height; ++r) {
+            for (int c = 0; c < grid_width; ++c) {
+                const bool fg = std::abs(cell(frame, r, c) - reference[static_cast<size_t>(r) * grid_width + c]) > s.threshold;
+                columns[c] += fg;
+                rows[r] += fg;
+                total += fg;
+            }
+        }
+        if (total < s.min_foreground * reference.size()) return frame.bounds();
+
+        auto first = [this](const std::vector<int>& counts) {
+            for (size_t i = 0; i < counts.size(); ++i)
+                if (counts[i] >= s.min_run) return static_cast<int>(i);
+            return -1;
+        };
+        auto last = [this](const std::vector<int>& counts) {
+            for (size_t i = counts.size(); i-- > 0;)
+                if (counts[i] >= s.min_run) return static_cast<int>(i);
+            return -1;
+        };
+        const int c0 = first(columns), c1 = last(columns), r0 = first(rows), r1 = last(rows);
+        if (c0 < 0 || r0 < 0) return frame.bounds();
+
+        float x0 = c0 * 2.0f, x1 = (c1 + 1) * 2.0f;
+        float y0 = static_cast<float>(r0 * row_step), y1 = static_cast<float>(std::min(frame.height, (r1 + 1) * row_step));
+        const float mx = (x1 - x0) * s.margin, my = (y1 - y0) * s.margin;
+        x0 -= mx;
+        x1 += mx;
+        y0 -= my;
+        y1 += my;
+        const float side = std::max({x1 - x0, y1 - y0, s.min_size * frame.height});
+        const int w = std::min(frame.width, static_cast<int>(std::ceil(side))) & ~1;
+        const int h = std::min(frame.height, static_cast<int>(std::ceil(side)));
+        const int x = std::clamp(static_cast<int>(std::lround((x0 + x1 - w) / 2)), 0, frame.width - w) & ~1;
+        const int y = std::clamp(static_cast<int>(std::lround((y0 + y1 - h) / 2)), 0, frame.height - h);
+        return {x, y, w, h};
+    }
+};
+
+static bool same(const Roi& a, const Roi& b)
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+static bool check(int width, int height)
+{
+    BackgroundSettings settings;
+    std::vector<uint8_t> belt(static_cast<size_t>(width) * height);
+    for (uint8_t& v : belt) v = static_cast<uint8_t>(90 + noise(50));
+
+    BackgroundModel model(settings);
+    ScalarModel scalar(settings, width, height);
+    for (int i = 0; i < settings.warmup_frames; ++i) {
+        const Frame frame = make_frame(belt, width, height, Roi());
+        model.learn(frame);
+        scalar.learn(frame);
+    }
+
+    // An empty belt, then objects anywhere, the right-hand edge (the scalar tail) included
+    int mismatches = 0, cropped = 0;
+    const int trials = 24;
+    for (int t = 0; t < trials; ++t) {
+        Roi object;
+        if (t > 0) {
+            object.width = 2 + std::abs(noise(width / 3));
+            object.height = 1 + std::abs(noise(height / 3));
+            object.x = t % 3 == 0 ? width - object.width : std::abs(noise(width)) % (width - object.width + 1);
+            object.y = std::abs(noise(height)) % (height - object.height + 1);
+        }
+        const Frame frame = make_frame(belt, width, height, object);
+        const Roi got = model.detect(frame), expected = scalar.detect(frame);
+        mismatches += !same(got, expected);
+        cropped += !same(got, frame.bounds());
+    }
+
+    const bool ok = mismatches == 0;
+    std::cout << (ok ? "ok   " : "FAIL ") << width << "x" << height << ": " << mismatches << " of " << trials
+              << " boxes differ from the scalar model (" << cropped << " cropped)\n";
+    return ok;
+}
+
+// A noise-free belt with a faint object exactly threshold + 1 above it,
+// inside a halo exactly at the threshold: only the object is foreground
+static bool check_threshold(int width, int height)
+{
+    BackgroundSettings settings;
+    std::vector<uint8_t> belt(static_cast<size_t>(width) * height);
+    for (uint8_t& v : belt) v = static_cast<uint8_t>(90 + noise(50));
+
+    BackgroundModel model(settings);
+    ScalarModel scalar(settings, width, height);
+    Frame frame = make_frame(belt, width, height, Roi());
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x) frame.data[static_cast<size_t>(y) * frame.stride() + x * 2] = belt[static_cast<size_t>(y) * width + x];
+    for (int i = 0; i < settings.warmup_frames; ++i) {
+        model.learn(frame);
+        scalar.learn(frame);
+    }
+
+    const Roi halo{width / 8, height / 8, width * 3 / 4, height * 3 / 4};
+    const Roi object{width * 3 / 8 + 1, height * 3 / 8, width / 4, height / 4};
+    auto inside = [](const Roi& r, int x, int y) { return x >= r.x && x < r.x + r.width && y >= r.y && y < r.y + r.height; };
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int lift = inside(object, x, y) ? settings.threshold + 1 : inside(halo, x, y) ? settings.threshold : 0;
+            frame.data[static_cast<size_t>(y) * frame.stride() + x * 2] = static_cast<uint8_t>(belt[static_cast<size_t>(y) * width + x] + lift);
+        }
+    }
+    const Roi got = model.detect(frame), expected = scalar.detect(frame);
+    const bool ok = same(got, expected) && !same(got, frame.bounds()) && got.width < halo.width;
+    std::cout << (ok ? "ok   " : "FAIL ") << width << "x" << height << " at the threshold: " << got.width << "x"
+              << got.height << "+" << got.x << "+" << got.y << ", scalar " << expected.width << "x" << expected.height
+              << "+" << expected.x << "+" << expected.y << "\n";
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    for (int width : {640, 638, 322, 100, 34, 18})
+        ok &= check(width, width * 3 / 4 + 1);
+    ok &= check(720, 576);
+    ok &= check_threshold(640, 480);
+    ok &= check_threshold(322, 242);
+    return ok ? 0 : 1;
+}
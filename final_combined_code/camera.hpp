@@ -0,0 +1,33 @@
+// camera.hpp
+#ifndef CAMERA_HPP
+#define CAMERA_HPP
+
+#include "frame.hpp"
+#include "streaming_ring.hpp"
+
+/**
+ * Frame source used by the capture service. Implemented by the V4L2
+ * webcam (persistent_v4l2_camera.hpp) and by ReplayCamera, which
+ * serves recorded frames so the pipeline runs without /dev/video0.
+ **/
+class Camera {
+public:
+    virtual ~Camera() = default;
+
+    // Starts continuous capture on a dedicated thread
+    virtual bool startStreaming(int affinity = -1, int priority = 0) = 0;
+
+    // One frame for the pipeline, nullptr on failure
+    virtual FramePtr capture() = 0;
+
+    // nullptr while not streaming
+    virtual StreamingRing* streamingRing() = 0;
+
+    // Newest streamed frame with its timestamp, nullptr if not streaming yet
+    FramePtr latest() {
+        StreamingRing* ring = streamingRing();
+        return ring ? ring->latest() : nullptr;
+    }
+};
+
+#endif // CAMERA_HPP
@@ -0,0 +1,169 @@
+#include "capture_log.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t align_up(uint64_t n)
+{
+    return (n + CAPTURE_LOG_ALIGN - 1) & ~static_cast<uint64_t>(CAPTURE_LOG_ALIGN - 1);
+}
+
+CaptureLogWriter::CaptureLogWriter(const std::string& path, uint64_t capacity_bytes)
+    : capacity(capacity_bytes)
+{
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw std::runtime_error("Failed to create capture log " + path);
+
+    // Reserve the blocks up front so appends never wait on the filesystem
+    if (posix_fallocate(fd, 0, capacity) != 0) {
+        close(fd);
+        throw std::runtime_error("Failed to preallocate capture log " + path);
+    }
+
+    void* map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map capture log " + path);
+    }
+    base = static_cast<uint8_t*>(map);
+
+    header = reinterpret_cast<CaptureLogHeader*>(base);
+    std::memcpy(header->magic, CAPTURE_LOG_MAGIC, sizeof(header->magic));
+    header->header_bytes = align_up(sizeof(CaptureLogHeader));
+    header->record_header_bytes = sizeof(CaptureLogRecord);
+    header->capacity_bytes = capacity;
+    header->write_offset = header->header_bytes;
+    header->record_count = 0;
+}
+
+CaptureLogWriter::~CaptureLogWriter()
+{
+    uint64_t used = header->write_offset;
+    munmap(base, capacity);
+    // Give back the unused part of the preallocation
+    if (ftruncate(fd, used) != 0) perror("ftruncate capture log");
+    close(fd);
+    if (dropped) std::cerr << "Capture log full, dropped " << dropped << " records\n";
+}
+
+int64_t CaptureLogWriter::append(const Frame& frame, float distance_cm, float gas_voltage)
+{
+    const uint64_t offset = header->write_offset;
+    const uint64_t record_bytes = align_up(sizeof(CaptureLogRecord) + frame.bytesused);
+    if (offset + record_bytes > capacity) {
+        dropped++;
+        return -1;
+    }
+
+    auto* record = reinterpret_cast<CaptureLogRecord*>(base + offset);
+    record->magic = CAPTURE_LOG_RECORD_MAGIC;
+    record->record_bytes = record_bytes;
+    record->index = header->record_count;
+    record->timestamp_us = frame.timestamp_us;
+    record->sequence = frame.sequence;
+    record->distance_cm = distance_cm;
+    record->gas_voltage = gas_voltage;
+    record->waste_class = -1;
+    record->confidence = 0.0f;
+    record->invoke_time_ms = 0.0f;
+    record->width = frame.width;
+    record->height = frame.height;
+    record->frame_bytes = frame.bytesused;
+    std::memcpy(base + offset + sizeof(CaptureLogRecord), frame.yuyv(), frame.bytesused);
+
+    // Publish the record only once it is complete, for readers of a live log
+    std::atomic_ref<uint64_t>(header->write_offset).store(offset + record_bytes, std::memory_order_release);
+    std::atomic_ref<uint64_t>(header->record_count).store(record->index + 1, std::memory_order_release);
+
+    return static_cast<int64_t>(offset);
+}
+
+void CaptureLogWriter::setResult(int64_t record_offset, const ClassificationResult& result)
+{
+    if (record_offset < static_cast<int64_t>(header->header_bytes) ||
+        static_cast<uint64_t>(record_offset) + sizeof(CaptureLogRecord) > capacity) return;
+    auto* record = reinterpret_cast<CaptureLogRecord*>(base + record_offset);
+    record->waste_class = static_cast<int32_t>(result.wasteClass);
+    record->confidence = result.confidence;
+    record->invoke_time_ms = result.invokeTimeMs;
+}
+
+CaptureLogReader::CaptureLogReader(const std::string& path)
+{
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open capture log " + path);
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CaptureLogHeader)) {
+        close(fd);
+        throw std::runtime_error("Truncated capture log " + path);
+    }
+    length = st.st_size;
+
+    void* map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map capture log " + path);
+    }
+    base = static_cast<const uint8_t*>(map);
+    header = reinterpret_cast<const CaptureLogHeader*>(base);
+
+    if (std::memcmp(header->magic, CAPTURE_LOG_MAGIC, sizeof(header->magic)) != 0 ||
+        header->record_header_bytes != sizeof(CaptureLogRecord)) {
+        munmap(const_cast<uint8_t*>(base), length);
+        close(fd);
+        throw std::runtime_error("Not a capture log: " + path);
+    }
+
+    refresh_end();
+    cursor = header->header_bytes;
+}
+
+CaptureLogReader::~CaptureLogReader()
+{
+    munmap(const_cast<uint8_t*>(base), length);
+    close(fd);
+}
+
+// Pairs with the writer's release store: everything before write_offset is complete
+void CaptureLogReader::refresh_end()
+{
+    const uint64_t written =
+        std::atomic_ref<uint64_t>(const_cast<uint64_t&>(header->write_offset)).load(std::memory_order_acquire);
+    end = std::min<uint64_t>(written, length);
+}
+
+bool CaptureLogReader::next(Entry& entry)
+{
+    // Caught up: pick up anything a live writer has appended since
+    if (cursor + sizeof(CaptureLogRecord) > end) refresh_end();
+    if (cursor + sizeof(CaptureLogRecord) > end) return false;
+
+    const auto* record = reinterpret_cast<const CaptureLogRecord*>(base + cursor);
+    if (record->magic != CAPTURE_LOG_RECORD_MAGIC || cursor + record->record_bytes > end) {
+        std::cerr << "Corrupt capture log record at offset " << cursor << "\n";
+        return false;
+    }
+
+    entry.record = record;
+    entry.yuyv = base + cursor + sizeof(CaptureLogRecord);
+    cursor += record->record_bytes;
+    return true;
+}
+
+bool CaptureLogReader::isCaptureLog(const std::string& path)
+{
+    char magic[sizeof(CAPTURE_LOG_MAGIC)] = {};
+    int f = open(path.c_str(), O_RDONLY);
+    if (f < 0) return false;
+    bool ok = read(f, magic, sizeof(magic)) == static_cast<ssize_t>(sizeof(magic)) &&
+              std::memcmp(magic, CAPTURE_LOG_MAGIC, sizeof(magic)) == 0;
+    close(f);
+    return ok;
+}
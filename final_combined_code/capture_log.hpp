@@ -0,0 +1,114 @@
+// capture_log.hpp
+#ifndef CAPTURE_LOG_HPP
+#define CAPTURE_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "classification.hpp"
+#include "frame.hpp"
+
+/**
+ * Append-only, memory-mapped session log of raw frames plus sensor
+ * metadata, for offline tuning and replay.
+ *
+ * Layout: a CaptureLogHeader followed by records, each a
+ * CaptureLogRecord immediately followed by frame_bytes of raw YUYV
+ * and padded to CAPTURE_LOG_ALIGN. The file is preallocated when it
+ * is created, so appending is a memcpy into the page cache.
+ **/
+static const char CAPTURE_LOG_MAGIC[8] = {'W', 'S', 'C', 'L', 'O', 'G', '0', '1'};
+static const uint32_t CAPTURE_LOG_RECORD_MAGIC = 0x52454331; // "REC1"
+static const size_t CAPTURE_LOG_ALIGN = 64;
+
+struct CaptureLogHeader {
+    char magic[8];
+    uint32_t header_bytes;
+    uint32_t record_header_bytes;
+    uint64_t capacity_bytes;
+    uint64_t write_offset;     // end of the last complete record
+    uint64_t record_count;
+};
+
+struct CaptureLogRecord {
+    uint32_t magic;
+    uint32_t record_bytes;     // header + frame + padding
+    uint64_t index;
+    uint64_t timestamp_us;     // V4L2 frame timestamp
+    uint32_t sequence;         // V4L2 frame sequence
+    float distance_cm;         // ultrasonic reading that triggered the capture
+    float gas_voltage;         // latest ADS1115 sample
+    int32_t waste_class;       // WasteClass, -1 until classified
+    float confidence;
+    float invoke_time_ms;
+    uint16_t width;
+    uint16_t height;
+    uint32_t frame_bytes;
+};
+
+class CaptureLogWriter {
+public:
+    CaptureLogWriter(const std::string& path, uint64_t capacity_bytes);
+    ~CaptureLogWriter();
+
+    CaptureLogWriter(const CaptureLogWriter&) = delete;
+    CaptureLogWriter& operator=(const CaptureLogWriter&) = delete;
+
+    // Appends a frame with its sensor readings; returns where the record
+    // is in the log, for setResult(), or -1 if the log is full
+    int64_t append(const Frame& frame, float distance_cm, float gas_voltage);
+
+    // Fills in the classification of a record appended earlier. Only
+    // touches that record, so it may run on another thread than append().
+    void setResult(int64_t record_offset, const ClassificationResult& result);
+
+    uint64_t recordCount() const { return header->record_count; }
+    uint64_t droppedCount() const { return dropped; }
+
+private:
+    int fd = -1;
+    uint8_t* base = nullptr;
+    uint64_t capacity = 0;
+    CaptureLogHeader* header = nullptr;
+    uint64_t dropped = 0;
+};
+
+/**
+ * Read-only view of a capture log. Records point straight into the
+ * mapping, nothing is copied. The log may still be being written:
+ * once next() reaches the end it checks for records appended since,
+ * so a reader can follow a live session by calling it again.
+ **/
+class CaptureLogReader {
+public:
+    struct Entry {
+        const CaptureLogRecord* record = nullptr;
+        const uint8_t* yuyv = nullptr;
+    };
+
+    explicit CaptureLogReader(const std::string& path);
+    ~CaptureLogReader();
+
+    CaptureLogReader(const CaptureLogReader&) = delete;
+    CaptureLogReader& operator=(const CaptureLogReader&) = delete;
+
+    // Iterates from the first record; returns false after the last one written so far
+    bool next(Entry& entry);
+    void rewind() { cursor = header->header_bytes; }
+
+    uint64_t recordCount() const { return header->record_count; }
+
+    static bool isCaptureLog(const std::string& path);
+
+private:
+    int fd = -1;
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    const CaptureLogHeader* header = nullptr;
+    uint64_t end = 0;
+    uint64_t cursor = 0;
+
+    void refresh_end();
+};
+
+#endif // CAPTURE_LOG_HPP
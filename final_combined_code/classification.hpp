@@ -0,0 +1,40 @@
+// classification.hpp
+#ifndef CLASSIFICATION_HPP
+#define CLASSIFICATION_HPP
+
+#include <string>
+
+enum class WasteClass { BIODEGRADABLE, NONBIODEGRADABLE, UNKNOWN };
+
+inline const char* toString(WasteClass wasteClass)
+{
+    switch (wasteClass) {
+    case WasteClass::BIODEGRADABLE:
+        return "biodegradable";
+    case WasteClass::NONBIODEGRADABLE:
+        return "nonbiodegradable";
+    default:
+        return "unknown";
+    }
+}
+
+// Folder names from the training set (labels.txt), see predict_tflite.py
+inline WasteClass wasteClassFromLabel(const std::string& label)
+{
+    if (label == "biodegradeable") return WasteClass::BIODEGRADABLE;
+    if (label == "nonbio") return WasteClass::NONBIODEGRADABLE;
+    return WasteClass::UNKNOWN;
+}
+
+struct ClassificationResult {
+    WasteClass wasteClass = WasteClass::UNKNOWN;
+    float confidence = 0.0f;
+    double preprocessTimeMs = 0.0;
+    double invokeTimeMs = 0.0;
+    int frames = 1;              // frames combined into the decision
+    double prefilterTimeMs = 0.0; // colour pre-classifier, not part of the two times above
+    bool prefiltered = false;     // decided by the pre-classifier, MobileNet never ran
+    bool cached = false;          // same scene as a recent item, its result reused
+};
+
+#endif // CLASSIFICATION_HPP
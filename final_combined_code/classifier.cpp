@@ -0,0 +1,205 @@
+#include "classifier.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+Classifier::Classifier(const std::string& model_path, const std::string& labels_path, int num_threads)
+{
+    load_labels(labels_path);
+
+    model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+    if (!model) throw std::runtime_error("Failed to load model " + model_path);
+
+    tflite::InterpreterBuilder(*model, resolver)(&interpreter);
+    if (!interpreter) throw std::runtime_error("Failed to build TFLite interpreter");
+
+    interpreter->SetNumThreads(num_threads);
+    if (interpreter->AllocateTensors() != kTfLiteOk)
+        throw std::runtime_error("Failed to allocate tensors");
+
+    auto supported = [](TfLiteType type) {
+        return type == kTfLiteFloat32 || type == kTfLiteUInt8 || type == kTfLiteInt8;
+    };
+
+    // Input is NHWC (1 x 224 x 224 x 3), float32 or quantized
+    const TfLiteTensor* in = interpreter->input_tensor(0);
+    if (!supported(in->type) || in->dims->size != 4 || in->dims->data[3] != 3)
+        throw std::runtime_error("Unexpected model input tensor");
+    input_height = in->dims->data[1];
+    input_width = in->dims->data[2];
+    input_type = in->type;
+    input_quant = in->params;
+
+    const TfLiteTensor* out = interpreter->output_tensor(0);
+    if (!supported(out->type))
+        throw std::runtime_error("Unexpected model output tensor");
+    num_classes = out->dims->data[out->dims->size - 1];
+    if (num_classes != labels.size())
+        throw std::runtime_error("Label count does not match model output");
+    output_type = out->type;
+    output_quant = out->params;
+
+    // The tensor buffers stay valid as long as AllocateTensors() isn't called again
+    switch (input_type) {
+    case kTfLiteUInt8: input = interpreter->typed_input_tensor<uint8_t>(0); break;
+    case kTfLiteInt8: input = reinterpret_cast<uint8_t*>(interpreter->typed_input_tensor<int8_t>(0)); break;
+    default: input = reinterpret_cast<uint8_t*>(interpreter->typed_input_tensor<float>(0)); break;
+    }
+    switch (output_type) {
+    case kTfLiteUInt8: raw_output = interpreter->typed_output_tensor<uint8_t>(0); break;
+    case kTfLiteInt8: raw_output = interpreter->typed_output_tensor<int8_t>(0); break;
+    default: raw_output = interpreter->typed_output_tensor<float>(0); break;
+    }
+    if (output_type == kTfLiteFloat32) {
+        output = static_cast<const float*>(raw_output);
+    } else {
+        dequantized.assign(num_classes, 0.0f);
+        output = dequantized.data();
+    }
+    preprocessor = std::make_unique<YuyvPreprocessor>(input_width, input_height);
+
+    std::cout << "Loaded " << model_path << " (" << input_width << "x" << input_height
+              << ", " << num_classes << " classes"
+              << (quantized() ? ", quantized input" : "") << ")\n";
+}
+
+void Classifier::load_labels(const std::string& labels_path)
+{
+    std::ifstream file(labels_path);
+    if (!file) throw std::runtime_error("Failed to open labels " + labels_path);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) labels.push_back(wasteClassFromLabel(line));
+    }
+}
+
+ClassificationResult Classifier::classify(const cv::Mat& bgr)
+{
+    cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
+    return classify_rgb();
+}
+
+void Classifier::fill_tensor(YuyvPreprocessor& preprocessor, const Frame& frame, const Roi& roi, uint8_t* tensor)
+{
+    const uint8_t* yuyv = frame.yuyv(roi);
+    switch (input_type) {
+    case kTfLiteUInt8:
+        preprocessor.toUint8Tensor(yuyv, roi.width, roi.height, frame.stride(), tensor,
+                                    input_quant.scale, input_quant.zero_point);
+        break;
+    case kTfLiteInt8:
+        preprocessor.toInt8Tensor(yuyv, roi.width, roi.height, frame.stride(),
+                                  reinterpret_cast<int8_t*>(tensor), input_quant.scale, input_quant.zero_point);
+        break;
+    default:
+        preprocessor.toFloatTensor(yuyv, roi.width, roi.height, frame.stride(),
+                                   reinterpret_cast<float*>(tensor));
+        break;
+    }
+}
+
+ClassificationResult Classifier::classify(const Frame& frame)
+{
+    auto start = std::chrono::steady_clock::now();
+    fill_tensor(*preprocessor, frame, frame.bounds(), input);
+    auto end = std::chrono::steady_clock::now();
+
+    ClassificationResult result = invoke();
+    result.preprocessTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+    return result;
+}
+
+double Classifier::preprocess(YuyvPreprocessor& preprocessor, const Frame& frame, uint8_t* tensor)
+{
+    return preprocess(preprocessor, frame, frame.bounds(), tensor);
+}
+
+double Classifier::preprocess(YuyvPreprocessor& preprocessor, const Frame& frame, const Roi& roi, uint8_t* tensor)
+{
+    auto start = std::chrono::steady_clock::now();
+    fill_tensor(preprocessor, frame, roi, tensor);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+ClassificationResult Classifier::classifyTensor(const uint8_t* tensor)
+{
+    std::memcpy(input, tensor, inputBytes());
+    return invoke();
+}
+
+ClassificationResult Classifier::classify_rgb()
+{
+    // Same preprocessing as predict_tflite.py: bicubic resize, MobileNetV2 scaling
+    auto start = std::chrono::steady_clock::now();
+    cv::resize(rgb, resized, cv::Size(input_width, input_height), 0, 0, cv::INTER_CUBIC);
+
+    // Quantized models: q = round(x / scale) + zero_point, saturated
+    const float inv_scale = 1.0f / input_quant.scale;
+    const int lo = input_type == kTfLiteInt8 ? -128 : 0;
+    size_t k = 0;
+    for (int y = 0; y < input_height; ++y) {
+        const uint8_t* row = resized.ptr<uint8_t>(y);
+        for (int x = 0; x < input_width * 3; ++x, ++k) {
+            const float value = row[x] / 127.5f - 1.0f;
+            if (input_type == kTfLiteFloat32) {
+                reinterpret_cast<float*>(input)[k] = value;
+                continue;
+            }
+            const int q = std::clamp(static_cast<int>(std::lround(value * inv_scale)) + input_quant.zero_point, lo, lo + 255);
+            if (input_type == kTfLiteInt8) reinterpret_cast<int8_t*>(input)[k] = static_cast<int8_t>(q);
+            else input[k] = static_cast<uint8_t>(q);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    ClassificationResult result = invoke();
+    result.preprocessTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+    return result;
+}
+
+ClassificationResult Classifier::classifyFile(const std::string& image_file)
+{
+    cv::Mat bgr = cv::imread(image_file, cv::IMREAD_COLOR);
+    if (bgr.empty()) {
+        std::cerr << "Failed to read " << image_file << "\n";
+        return {};
+    }
+    return classify(bgr);
+}
+
+ClassificationResult Classifier::invoke()
+{
+    ClassificationResult result;
+
+    auto start = std::chrono::steady_clock::now();
+    if (interpreter->Invoke() != kTfLiteOk) {
+        std::cerr << "TFLite invoke failed\n";
+        return result;
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.invokeTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (output_type == kTfLiteUInt8) {
+        const uint8_t* raw = static_cast<const uint8_t*>(raw_output);
+        for (size_t i = 0; i < num_classes; ++i)
+            dequantized[i] = (raw[i] - output_quant.zero_point) * output_quant.scale;
+    } else if (output_type == kTfLiteInt8) {
+        const int8_t* raw = static_cast<const int8_t*>(raw_output);
+        for (size_t i = 0; i < num_classes; ++i)
+            dequantized[i] = (raw[i] - output_quant.zero_point) * output_quant.scale;
+    }
+
+    size_t top = 0;
+    for (size_t i = 1; i < num_classes; ++i) {
+        if (output[i] > output[top]) top = i;
+    }
+    result.wasteClass = labels[top];
+    result.confidence = output[top];
+    return result;
+}
@@ -0,0 +1,96 @@
+// classifier.hpp
+#ifndef CLASSIFIER_HPP
+#define CLASSIFIER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "classification.hpp"
+#include "frame.hpp"
+#include "preprocess.hpp"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model.h"
+
+/**
+ * In-process TFLite classifier for the MobileNetV2 waste model.
+ * The model is loaded and the tensors are allocated once in the
+ * constructor; every classify() call only fills the input tensor
+ * and invokes the persistent interpreter.
+ *
+ * Float32 models and fully quantized ones (uint8 or int8 input and
+ * output, see model_training/convert_to_tflite.py --int8) are both
+ * accepted. Quantized inputs are written directly from YUYV by the
+ * preprocessor; quantized outputs are dequantized to probabilities.
+ **/
+class Classifier {
+public:
+    Classifier(const std::string& model_path = "model_new_kaggle_dataset.tflite",
+               const std::string& labels_path = "labels.txt",
+               int num_threads = 1);
+
+    // Classifies a BGR image (as returned by cv::imread)
+    ClassificationResult classify(const cv::Mat& bgr);
+
+    // Classifies a raw YUYV frame straight from the camera using the fused preprocessor
+    ClassificationResult classify(const Frame& frame);
+
+    ClassificationResult classifyFile(const std::string& image_file);
+
+    // Split form of classify(const Frame&) so the two halves can run as
+    // separate pipeline stages: preprocess() fills a buffer of inputBytes()
+    // in the model's input type and returns the time it took in ms,
+    // classifyTensor() runs the model on it. A YuyvPreprocessor keeps
+    // scratch rows and resize taps between calls, so every thread that
+    // preprocesses passes its own, sized inputWidth() x inputHeight().
+    // classifyTensor() and classify() share the interpreter and stay on
+    // one thread; preprocess() may run alongside them.
+    double preprocess(YuyvPreprocessor& preprocessor, const Frame& frame, uint8_t* tensor);
+
+    // Same, for only a region of the frame, resized to fill the whole input
+    double preprocess(YuyvPreprocessor& preprocessor, const Frame& frame, const Roi& roi, uint8_t* tensor);
+    ClassificationResult classifyTensor(const uint8_t* tensor);
+
+    size_t inputSize() const { return static_cast<size_t>(input_width) * input_height * 3; }
+    size_t inputBytes() const { return inputSize() * (input_type == kTfLiteFloat32 ? sizeof(float) : 1); }
+    bool quantized() const { return input_type != kTfLiteFloat32; }
+
+    // Output of the last invoke, one probability per class; valid until the next one
+    const float* probabilities() const { return output; }
+    size_t numClasses() const { return num_classes; }
+    WasteClass label(size_t index) const { return labels[index]; }
+
+    int inputWidth() const { return input_width; }
+    int inputHeight() const { return input_height; }
+
+private:
+    std::unique_ptr<tflite::FlatBufferModel> model;
+    tflite::ops::builtin::BuiltinOpResolver resolver;
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    std::vector<WasteClass> labels;
+
+    int input_width = 224;
+    int input_height = 224;
+    TfLiteType input_type = kTfLiteFloat32;
+    TfLiteQuantizationParams input_quant{1.0f, 0};
+    uint8_t* input = nullptr;
+    TfLiteType output_type = kTfLiteFloat32;
+    TfLiteQuantizationParams output_quant{1.0f, 0};
+    const void* raw_output = nullptr;
+    const float* output = nullptr;       // probabilities, dequantized for quantized models
+    std::vector<float> dequantized;
+    size_t num_classes = 0;
+
+    // Scratch images reused between calls to avoid reallocations; the
+    // preprocessor is classify(const Frame&)'s own
+    cv::Mat rgb, resized;
+    std::unique_ptr<YuyvPreprocessor> preprocessor;
+
+    void load_labels(const std::string& labels_path);
+    void fill_tensor(YuyvPreprocessor& preprocessor, const Frame& frame, const Roi& roi, uint8_t* tensor);
+    ClassificationResult classify_rgb();
+    ClassificationResult invoke();
+};
+
+#endif // CLASSIFIER_HPP
@@ -0,0 +1,148 @@
+#include "color_prefilter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+ColorPrefilter::ColorPrefilter(const std::string& weights_path, float confidence)
+    : confidence(confidence)
+{
+    std::ifstream file(weights_path);
+    if (!file) throw std::runtime_error("Failed to open pre-classifier weights " + weights_path);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        if (labels.empty()) {
+            std::string key, name;
+            in >> key;
+            if (key != "classes") throw std::runtime_error("Pre-classifier weights must start with the classes");
+            while (in >> name) labels.push_back(wasteClassFromLabel(name));
+            continue;
+        }
+
+        float b;
+        Features w;
+        in >> b;
+        for (float& v : w) in >> v;
+        if (!in) throw std::runtime_error("Short pre-classifier weights row in " + weights_path);
+        bias.push_back(b);
+        weights.push_back(w);
+    }
+    if (labels.empty() || weights.size() != labels.size())
+        throw std::runtime_error("Pre-classifier weights don't match the classes in " + weights_path);
+    scores.resize(labels.size());
+
+    std::cout << "Loaded pre-classifier " << weights_path << " (" << labels.size()
+              << " classes, confidence " << confidence << ")\n";
+}
+
+// Histogram increments stay scalar: storing SIMD bin indices and reloading
+// them byte by byte was slower than shifting the source bytes directly
+static inline void count_pairs(const uint8_t* pairs, int n, uint32_t* chroma, uint32_t* luma0, uint32_t* luma1)
+{
+    for (int i = 0; i < n * 4; i += 4) {
+        luma0[pairs[i] >> 5]++;
+        luma1[pairs[i + 2] >> 5]++;
+        chroma[(pairs[i + 1] >> 5) * 8 + (pairs[i + 3] >> 5)]++;
+    }
+}
+
+void ColorPrefilter::features(const uint8_t* yuyv, int width, int height, size_t stride, Features& out)
+{
+    // Separate tables for Y0 and Y1 so neighbouring increments don't wait on each other
+    uint32_t chroma[CHROMA_BINS] = {};
+    uint32_t luma0[LUMA_BINS] = {}, luma1[LUMA_BINS] = {};
+    uint64_t hsum = 0, vsum = 0, pairs = 0;
+    const int n = width / 2;
+
+    for (int y = 0; y + 1 < height; y += ROW_STEP) {
+        const uint8_t* row = yuyv + static_cast<size_t>(y) * stride;
+        const uint8_t* below = row + stride;
+        int p = 0;
+#if defined(__ARM_NEON)
+        // 16 pairs at a time, de-interleaved into Y0, U, Y1, V
+        uint32x4_t hacc = vdupq_n_u32(0), vacc = vdupq_n_u32(0);
+        for (; p + 16 <= n; p += 16) {
+            uint8x16x4_t a = vld4q_u8(row + p * 4);
+            uint8x16x4_t b = vld4q_u8(below + p * 4);
+            hacc = vpadalq_u16(hacc, vpaddlq_u8(vabdq_u8(a.val[0], a.val[2])));
+            vacc = vpadalq_u16(vacc, vpaddlq_u8(vabdq_u8(a.val[0], b.val[0])));
+            vacc = vpadalq_u16(vacc, vpaddlq_u8(vabdq_u8(a.val[2], b.val[2])));
+            count_pairs(row + p * 4, 16, chroma, luma0, luma1);
+        }
+        hsum += vaddvq_u32(hacc);
+        vsum += vaddvq_u32(vacc);
+#elif defined(__SSE2__)
+        // 4 pairs (16 bytes) at a time. The Y bytes are masked out so a
+        // SAD of two masked vectors sums only luma differences.
+        const __m128i ymask = _mm_set1_epi16(0x00ff);
+        const __m128i lowmask = _mm_set1_epi32(0xff);
+        __m128i hacc = _mm_setzero_si128(), vacc = _mm_setzero_si128();
+        for (; p + 4 <= n; p += 4) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + p * 4));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + p * 4));
+            vacc = _mm_add_epi64(vacc, _mm_sad_epu8(_mm_and_si128(a, ymask), _mm_and_si128(b, ymask)));
+            hacc = _mm_add_epi64(hacc, _mm_sad_epu8(_mm_and_si128(a, lowmask),
+                                                    _mm_and_si128(_mm_srli_epi32(a, 16), lowmask)));
+            count_pairs(row + p * 4, 4, chroma, luma0, luma1);
+        }
+        hsum += static_cast<uint64_t>(_mm_cvtsi128_si32(hacc)) + _mm_cvtsi128_si32(_mm_srli_si128(hacc, 8));
+        vsum += static_cast<uint64_t>(_mm_cvtsi128_si32(vacc)) + _mm_cvtsi128_si32(_mm_srli_si128(vacc, 8));
+#endif
+        count_pairs(row + p * 4, n - p, chroma, luma0, luma1);
+        for (; p < n; ++p) {
+            const uint8_t* a = row + p * 4;
+            const uint8_t* b = below + p * 4;
+            hsum += std::abs(a[0] - a[2]);
+            vsum += std::abs(a[0] - b[0]) + std::abs(a[2] - b[2]);
+        }
+        pairs += n;
+    }
+
+    const float per_pair = pairs ? 1.0f / pairs : 0.0f;
+    for (int i = 0; i < CHROMA_BINS; ++i) out[i] = chroma[i] * per_pair;
+    for (int i = 0; i < LUMA_BINS; ++i) out[CHROMA_BINS + i] = (luma0[i] + luma1[i]) * per_pair * 0.5f;
+    out[CHROMA_BINS + LUMA_BINS] = hsum * per_pair / 255.0f;
+    out[CHROMA_BINS + LUMA_BINS + 1] = vsum * per_pair * 0.5f / 255.0f;
+}
+
+bool ColorPrefilter::classify(const Frame& frame, const Roi& roi, ClassificationResult& result)
+{
+    auto start = std::chrono::steady_clock::now();
+    features(frame.yuyv(roi), roi.width, roi.height, frame.stride(), x);
+
+    // Softmax over the linear scores
+    float top = -INFINITY;
+    size_t best = 0;
+    for (size_t k = 0; k < labels.size(); ++k) {
+        float s = bias[k];
+        for (int i = 0; i < FEATURES; ++i) s += weights[k][i] * x[i];
+        scores[k] = s;
+        if (s > top) {
+            top = s;
+            best = k;
+        }
+    }
+    float sum = 0.0f;
+    for (float s : scores) sum += std::exp(s - top);
+    auto end = std::chrono::steady_clock::now();
+
+    result = {};
+    result.wasteClass = labels[best];
+    result.confidence = 1.0f / sum;
+    result.prefilterTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+    result.prefiltered = result.confidence >= confidence && result.wasteClass != WasteClass::UNKNOWN;
+    return result.prefiltered;
+}
@@ -0,0 +1,67 @@
+// color_prefilter.hpp
+#ifndef COLOR_PREFILTER_HPP
+#define COLOR_PREFILTER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "classification.hpp"
+#include "frame.hpp"
+
+/**
+ * Cheap first stage in front of MobileNetV2. Food scraps and plastic
+ * wrap are often told apart by colour alone, so the raw YUYV frame is
+ * reduced to a few histograms on a row-subsampled grid and scored with
+ * a linear softmax model trained offline by
+ * model_training/train_prefilter.py. Only when the top class falls
+ * short of the confidence threshold does the item go on to MobileNet.
+ *
+ * Features, in this order (train_prefilter.py computes the same):
+ *   64  joint U/V histogram, 8 x 8 bins (U >> 5, V >> 5), per pixel pair
+ *    8  Y histogram (Y >> 5), per pixel
+ *    1  mean |Y0 - Y1| within a pixel pair / 255      (horizontal texture)
+ *    1  mean |Y - Y of the row below| / 255            (vertical texture)
+ * over every ROW_STEP-th row. The texture sums are computed with NEON
+ * or SSE2 absolute differences; the histogram increments are scalar.
+ **/
+class ColorPrefilter {
+public:
+    static constexpr int CHROMA_BINS = 64;
+    static constexpr int LUMA_BINS = 8;
+    static constexpr int FEATURES = CHROMA_BINS + LUMA_BINS + 2;
+    static constexpr int ROW_STEP = 4;
+
+    using Features = std::array<float, FEATURES>;
+
+    /**
+     * Weights file written by train_prefilter.py: a "classes" line with
+     * the label names, then one line per class with the bias followed
+     * by FEATURES weights. Throws std::runtime_error if it doesn't fit.
+     **/
+    explicit ColorPrefilter(const std::string& weights_path, float confidence = 0.95f);
+
+    // Features of a width x height YUYV image (stride in bytes), width even
+    static void features(const uint8_t* yuyv, int width, int height, size_t stride, Features& out);
+
+    /**
+     * Top class and its probability for a region of the frame (the
+     * part MobileNet would see), with the time taken in
+     * prefilterTimeMs. Returns true if it is confident enough to skip
+     * MobileNet; the result is filled in either way.
+     **/
+    bool classify(const Frame& frame, const Roi& roi, ClassificationResult& result);
+
+    float threshold() const { return confidence; }
+
+private:
+    const float confidence;
+    std::vector<WasteClass> labels;
+    std::vector<Features> weights;
+    std::vector<float> bias;
+    std::vector<float> scores;
+    Features x{};
+};
+
+#endif // COLOR_PREFILTER_HPP
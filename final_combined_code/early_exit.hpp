@@ -0,0 +1,58 @@
+// early_exit.hpp
+#ifndef EARLY_EXIT_HPP
+#define EARLY_EXIT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+struct EarlyExitSettings {
+    // Frames an item may take; 1 decides on the trigger frame alone
+    int max_frames = 1;
+
+    // Stop once the combined top class reaches this probability
+    float confidence = 0.8f;
+
+    // No further frames are taken this long after the trigger
+    double deadline_ms = 500.0;
+};
+
+/**
+ * Soft vote over the frames of one item: each frame's class
+ * probabilities are averaged in, and the combined decision is the top
+ * class of the average. A clear first frame settles it on its own;
+ * an ambiguous one needs agreeing frames to pull the average over the
+ * threshold, and one contradicting frame pulls it back down.
+ **/
+class FrameVote {
+public:
+    explicit FrameVote(size_t classes) : sums(classes, 0.0) {}
+
+    void reset() {
+        std::fill(sums.begin(), sums.end(), 0.0);
+        count = 0;
+    }
+
+    void add(const float* probabilities) {
+        for (size_t i = 0; i < sums.size(); ++i) sums[i] += probabilities[i];
+        count++;
+    }
+
+    size_t frames() const { return count; }
+
+    size_t top() const {
+        size_t best = 0;
+        for (size_t i = 1; i < sums.size(); ++i)
+            if (sums[i] > sums[best]) best = i;
+        return best;
+    }
+
+    // Mean probability of the top class
+    float confidence() const { return count ? static_cast<float>(sums[top()] / count) : 0.0f; }
+
+private:
+    std::vector<double> sums;
+    size_t count = 0;
+};
+
+#endif // EARLY_EXIT_HPP
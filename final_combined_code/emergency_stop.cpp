@@ -0,0 +1,38 @@
+#include "emergency_stop.hpp"
+#include <time.h>
+
+static uint64_t now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+EmergencyStop::EmergencyStop(DigitalOutput& cutoff, EmergencySettings settings)
+    : cutoff(cutoff), settings(settings), filter(settings.filter)
+{
+    cutoff.write(false);
+}
+
+void EmergencyStop::process(const Sample& sample)
+{
+    const float level = filter.step(sample.volts);
+    current.store(level, std::memory_order_relaxed);
+
+    if (!active.load(std::memory_order_relaxed) && level > settings.trip_volts) {
+        cutoff.write(true);
+        const uint64_t done_us = now_us();
+        active.store(true, std::memory_order_release);
+
+        // Guard against a source stamping samples from another clock
+        const uint64_t latency_us = done_us > sample.timestamp_us ? done_us - sample.timestamp_us : 0;
+        last_cutoff_us.store(latency_us, std::memory_order_relaxed);
+        cutoff_latency.record(latency_us / 1000.0);
+        trip_count.fetch_add(1, std::memory_order_relaxed);
+        if (trip_hook) trip_hook();
+    } else if (active.load(std::memory_order_relaxed) && level < settings.reset_volts) {
+        cutoff.write(false);
+        active.store(false, std::memory_order_release);
+        if (reset_hook) reset_hook();
+    }
+}
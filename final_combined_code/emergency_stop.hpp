@@ -0,0 +1,68 @@
+// emergency_stop.hpp
+#ifndef EMERGENCY_STOP_HPP
+#define EMERGENCY_STOP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "hal.hpp"
+#include "latency_histogram.hpp"
+#include "sample_filter.hpp"
+
+struct EmergencySettings {
+    // Hysteresis on the filtered MQ-7 voltage
+    float trip_volts = 1.9f;
+    float reset_volts = 1.7f;
+
+    // Only the low-pass part is used; every sample is checked, not just decimated outputs
+    FilterSettings filter;
+};
+
+/**
+ * Gas alarm that acts on every ADC sample, on the sampling thread
+ * itself: the filtered level is checked as each sample arrives and
+ * the motor cutoff is switched before anything else happens, instead
+ * of waiting for the next Gas Monitor release. The trip and reset
+ * hooks then run on the same thread, so they must only signal other
+ * threads (halt the actuator, set a flag), never block.
+ *
+ * The time from the tripping sample's timestamp to the cutoff write
+ * returning is recorded in a histogram.
+ **/
+class EmergencyStop {
+public:
+    using Hook = std::function<void()>;
+
+    explicit EmergencyStop(DigitalOutput& cutoff, EmergencySettings settings = EmergencySettings());
+
+    // Set before samples arrive
+    void onTrip(Hook hook) { trip_hook = std::move(hook); }
+    void onReset(Hook hook) { reset_hook = std::move(hook); }
+
+    // Every raw sample, from the sampling thread
+    void process(const Sample& sample);
+
+    bool tripped() const { return active.load(std::memory_order_acquire); }
+    uint64_t trips() const { return trip_count.load(std::memory_order_relaxed); }
+
+    // Filtered voltage as of the latest sample
+    float level() const { return current.load(std::memory_order_relaxed); }
+
+    // Sample timestamp to cutoff, most recent trip and all of them
+    uint64_t lastCutoffUs() const { return last_cutoff_us.load(std::memory_order_relaxed); }
+    HistogramSnapshot cutoffLatency() const { return cutoff_latency.snapshot(); }
+
+private:
+    DigitalOutput& cutoff;
+    const EmergencySettings settings;
+    DecimatingFilter filter;
+    Hook trip_hook, reset_hook;
+
+    std::atomic<bool> active{false};
+    std::atomic<float> current{0.0f};
+    std::atomic<uint64_t> trip_count{0};
+    std::atomic<uint64_t> last_cutoff_us{0};
+    LatencyHistogram cutoff_latency;
+};
+
+#endif // EMERGENCY_STOP_HPP
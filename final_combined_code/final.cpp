@@ -1,181 +1,738 @@
 #include <iostream>
 #include <csignal>
-#include <wiringPi.h>
+#include <cstdio>
 #include <opencv2/opencv.hpp>
-#include "ads1115rpi.h"
-#include "servo.hpp"
+#include "hal.hpp"
+#include "servo_actuator.hpp"
 #include "Sequencer.hpp"
+#include <array>
 #include <chrono>
 #include <atomic>
 #include <condition_variable>
+#include <filesystem>
+#include <fstream>
 #include "persistent_v4l2_camera.hpp"
-
-#define MOSFET_WPI_PIN 6
-#define TRIG_PIN 4
-#define ECHO_PIN 5
+#include "replay_camera.hpp"
+#include "classifier.hpp"
+#include "capture_log.hpp"
+#include "pipeline.hpp"
+#include "ultrasonic.hpp"
+#include "sample_filter.hpp"
+#include "emergency_stop.hpp"
+#include "early_exit.hpp"
+#include "color_prefilter.hpp"
+#include "result_cache.hpp"
+#include "background_model.hpp"
+#include "motion_trigger.hpp"
+#include "approach_predictor.hpp"
 
 std::atomic<bool> keepRunning{true};
-std::atomic<bool> frame_ready(false);
-std::atomic<bool> processing_in_progress(false);
 std::atomic<bool> stop_threads(false);
-std::mutex frame_mutex, mtx;
+std::mutex mtx;
 std::condition_variable cv_capture;
-std::string saved_image_path = "capture.jpg";
 
-enum class SystemState { RUNNING, EMERGENCY };
-std::atomic<SystemState> systemState{SystemState::RUNNING};
+// Items flow capture -> preprocess -> inference -> actuator through bounded
+// queues, up to PIPELINE_DEPTH of them at once. Frames stay in memory; set
+// SAVE_CAPTURES to also keep a JPEG copy of each capture for debugging.
+const size_t PIPELINE_DEPTH = 4;
+std::unique_ptr<PipelineItemPool> item_pool;
+ItemQueue<PIPELINE_DEPTH> to_preprocess, to_inference;
+const bool SAVE_CAPTURES = false;
+const std::string saved_image_path = "capture.jpg";
+
+// --serial takes one item at a time, from trigger until its gate is back at
+// rest, like the system did before it was pipelined. --bench <n> triggers on
+// every capture release instead of the ultrasonic sensor and stops after n
+// items (use with --replay to measure throughput).
+bool serial_mode = false;
+uint64_t bench_items = 0;
+
+// --frames <n> lets an ambiguous item take up to n frames from the stream,
+// until the averaged class probabilities clear --exit-confidence or
+// --frame-deadline ms have passed since the trigger (see early_exit.hpp);
+// not with --roi, whose crop only fits the trigger frame
+EarlyExitSettings early_exit;
+
+// --prefilter <weights> puts the colour/texture pre-classifier in front of
+// MobileNet: items it is at least --prefilter-confidence sure of skip the
+// model (see color_prefilter.hpp, model_training/train_prefilter.py)
+std::unique_ptr<ColorPrefilter> prefilter;
+
+// --cache-distance <bits> reuses the result of a recent item whose frame
+// hashes within that many bits, so retriggers on a stalled item or a
+// stopped belt don't run the model again (see result_cache.hpp)
+std::unique_ptr<ResultCache> result_cache;
+
+// --roi learns the empty belt from the stream while nothing is under the
+// sensor, and crops each capture to what differs from it before it is
+// resized into the model input (see background_model.hpp)
+std::unique_ptr<BackgroundModel> background;
+
+// --trigger vision replaces the ultrasonic sensor with the camera stream:
+// MotionTrigger watches every frame and hands over the one where the
+// arriving object has settled (see motion_trigger.hpp)
+std::unique_ptr<MotionTrigger> motion_trigger;
+FrameHandoff triggered_frames;
+
+// --predict-arrival fits the approach speed to the last few ultrasonic
+// readings and, when the object will reach the imaging position before the
+// next capture period, releases the capture service at that instant and
+// takes the first frame stamped after it (see approach_predictor.hpp)
+std::unique_ptr<ApproachPredictor> approach;
+ScheduledRelease* arrival_release = nullptr;
+const uint32_t CAPTURE_PERIOD_MS = 200;
+
+// A predicted arrival closer than this is waited for in the same run, as a
+// release at that point would land while the service is still busy
+const uint64_t ARRIVAL_GUARD_US = 5000;
+
+struct PipelineStats {
+    std::atomic<uint64_t> triggered{0};
+    std::atomic<uint64_t> finished{0};   // sorted, or classified as unknown
+    std::atomic<uint64_t> stalls{0};     // triggers deferred because the pipeline was full
+    std::atomic<uint64_t> classified{0};
+    std::atomic<uint64_t> frames_classified{0};
+    std::atomic<uint64_t> early_exits{0};  // confident before the frame budget ran out
+    std::atomic<uint64_t> prefiltered{0};  // decided by the pre-classifier alone
+    LatencyHistogram prefilter_latency;    // every item
+    LatencyHistogram mobilenet_latency;    // preprocess + invoke, items the pre-classifier passed on
+    LatencyHistogram background_latency;   // learn or detect, per capture period
+    std::atomic<uint64_t> cropped{0};
+    double crop_area = 0.0;                // sum of cropped fractions of the frame, capture thread only
+    LatencyHistogram arrival_lead;         // predicted arrival to the next capture period, scheduled captures
+    uint64_t first_trigger_us = 0;
+    std::atomic<uint64_t> last_finish_us{0};
+};
+PipelineStats pipeline_stats;
+
+// Optional session recording (--log <file>). Each item remembers its record
+// so the inference stage can fill in the result.
+std::unique_ptr<CaptureLogWriter> capture_log;
+const uint64_t CAPTURE_LOG_CAPACITY = 1024ULL * 1024 * 1024;
+
+std::atomic<float> gas_voltage{0.0f};
 
-void signalHandler(int signum) {
+void signalHandler(int) {
     std::cout << "\nSIGINT received. Stopping...\n";
     keepRunning = false;
     stop_threads = true;
 }
 
-class MQ7Callback : public ADS1115rpi::ADSCallbackInterface {
-public:
-    void hasADS1115Sample(float sample) override {
-        if (sample > 1.9f && systemState != SystemState::EMERGENCY) {
-            systemState = SystemState::EMERGENCY;
-            std::cout << "ALERT: Gas level high! Emergency stop.\n";
-        } else if (sample < 1.7f && systemState == SystemState::EMERGENCY) {
-            systemState = SystemState::RUNNING;
-            std::cout << "Gas level safe. Resuming.\n";
-        }
-    }
-};
+// Real Raspberry Pi peripherals, or simulated ones with --sim (see hal.hpp)
+Hardware hardware;
+
+// Frames for a simulated run without --replay, relative to final_combined_code
+const std::string SIM_SAMPLE_IMAGES = "../model_training/kaggle_new_dataset";
+
+// The gas sensor's thread checks every sample against the alarm level
+// itself (EmergencyStop switches the MOSFET, halts the gates and pauses
+// the pipeline) and queues it; the Gas Monitor service drains the queue
+// in batches for the decimated level that gets logged and reported.
+SampleRing gas_samples;
+FilterSettings gas_filter_settings;
+std::unique_ptr<EmergencyStop> emergency;
 
 void gas_service() {
-    static MQ7Callback cb;
-    static ADS1115rpi reader;
-    static bool initialized = false;
-
-    if (!initialized) {
-        ADS1115settings settings;
-        settings.channel = ADS1115settings::AIN0;
-        settings.pgaGain = ADS1115settings::FSR2_048;
-        settings.samplingRate = ADS1115settings::FS860HZ; // Changing sampling rate from 8 samples/sec to 860 samples/sec
-        reader.registerCallback(&cb);
-        reader.start(settings);
-        initialized = true;
-    }
-
-    if (systemState == SystemState::EMERGENCY)
-        digitalWrite(MOSFET_WPI_PIN, HIGH);
-    else
-        digitalWrite(MOSFET_WPI_PIN, LOW);
+    static DecimatingFilter filter(gas_filter_settings);
+    static std::array<Sample, SampleRing::CAPACITY> batch;
+    static std::vector<Sample> filtered;
+    static uint64_t reported_trips = 0;
+    static bool reported_active = false;
+
+    // Started from the service thread so the sampling thread inherits its core and priority
+    static bool started = false;
+    if (!started) {
+        hardware.gas->start(gas_samples);
+        started = true;
+    }
+
+    size_t n = gas_samples.popBatch(batch.data(), batch.size());
+    filtered.clear();
+    filter.process(batch.data(), n, filtered);
+    if (!filtered.empty()) gas_voltage.store(filtered.back().volts, std::memory_order_relaxed);
+
+    // Only reporting here: the cutoff already happened on the sampling thread
+    const uint64_t trips = emergency->trips();
+    if (trips != reported_trips) {
+        reported_trips = trips;
+        reported_active = true;
+        std::cout << "ALERT: Gas level high! Emergency stop (motor cut off "
+                  << emergency->lastCutoffUs() / 1000.0 << " ms after the sample).\n";
+    }
+    if (reported_active && !emergency->tripped()) {
+        reported_active = false;
+        std::cout << "Gas level safe. Resuming.\n";
+    }
+}
+
+std::unique_ptr<UltrasonicRanger> ranger;
+
+// Distance, and when it was read: halfway through the pings
+float read_distance(uint64_t& reading_us) {
+    const uint64_t start = monotonic_us();
+    const float distance = ranger->measure();
+    reading_us = (start + monotonic_us()) / 2;
+    std::cout << "Measured distance: " << distance << " cm (" << ranger->lastCpuUs() << " us CPU)\n";
+    return distance;
+}
+
+// First streamed frame stamped after `timestamp_us`, the newest one if that is already past
+FramePtr frame_at(Camera& camera, uint64_t timestamp_us) {
+    if (StreamingRing* ring = camera.streamingRing())
+        if (FramePtr frame = ring->waitNewer(timestamp_us - 1, std::chrono::milliseconds(100))) return frame;
+    return camera.capture();
 }
 
-float measure_distance() {
-    digitalWrite(TRIG_PIN, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(TRIG_PIN, LOW);
-    while (digitalRead(ECHO_PIN) == LOW);
-    long start_time = micros();
-    while (digitalRead(ECHO_PIN) == HIGH);
-    long end_time = micros();
-    return (end_time - start_time) * 0.0343 / 2.0;
+void finish_item() {
+    pipeline_stats.last_finish_us = monotonic_us();
+    pipeline_stats.finished++;
 }
 
+// Stage 1, trigger + capture: an item is an object arriving under the sensor,
+// and the sensor is re-armed once it has gone. With the vision trigger the
+// item is the frame it handed over instead. Returns true when an item was
+// queued for preprocessing.
+bool capture_stage(Camera& camera, ServoActuator& actuator) {
+    static bool armed = true;
+    static uint64_t next_item_id = 0;
+    // Vision trigger frame that found the pipeline full, retried before any newer one
+    static FramePtr held;
 
-void capture_frames(PersistentV4L2Camera& camera) {
-    // auto start = std::chrono::steady_clock::now();
-    
-    if (processing_in_progress) return;
-    float distance = measure_distance();
-    std::cout << "Measured distance: " << distance << " cm\n";
-    if (distance < 20.0) {
-        if (camera.captureToFile(saved_image_path)) {
-            frame_ready = true;
-            processing_in_progress = true;
-            std::cout << "Captured " << saved_image_path << "\n";
-        } else {
-            std::cerr << "Failed to capture frame\n";
+    if (emergency->tripped()) return false;
+    if (serial_mode && (item_pool->inFlight() > 0 || actuator.outstanding() > 0)) return false;
+    if (bench_items && pipeline_stats.triggered >= bench_items) return false;
+
+    float distance = 0.0f;
+    bool belt_empty = false;
+    FramePtr frame;
+    if (motion_trigger) {
+        frame = held ? std::move(held) : triggered_frames.take();
+        belt_empty = motion_trigger->idle();
+    } else if (!bench_items) {
+        const uint64_t run_us = monotonic_us();
+        uint64_t reading_us = 0;
+        // A release for a predicted arrival goes straight to the frame
+        if (!approach || !approach->pending() || run_us + ARRIVAL_GUARD_US < approach->pending()) {
+            distance = read_distance(reading_us);
+            if (distance >= 22.0) armed = true;
+            if (approach) {
+                approach->add(reading_us, distance);
+                if (approach->pending() && distance < 20.0) {
+                    // Got there before the prediction
+                    std::cout << "Arrival prediction error: " << approach->score(reading_us, distance) << " ms\n";
+                    arrival_release->cancel();
+                } else if (armed && distance >= 20.0) {
+                    const uint64_t predicted_us = approach->predict();
+                    const uint64_t next_period_us = run_us + CAPTURE_PERIOD_MS * 1000ULL;
+                    if (predicted_us && predicted_us < next_period_us) {
+                        const int64_t ahead_us = static_cast<int64_t>(predicted_us) - static_cast<int64_t>(monotonic_us());
+                        std::cout << "Approaching at " << approach->speed() << " cm/s, arrival predicted in "
+                                  << ahead_us / 1000.0 << " ms\n";
+                        pipeline_stats.arrival_lead.record((next_period_us - predicted_us) / 1000.0);
+                        if (monotonic_us() + ARRIVAL_GUARD_US < predicted_us) arrival_release->at(predicted_us);
+                    } else {
+                        // Not before the next period, which predicts again with one more reading
+                        approach->cancel();
+                        arrival_release->cancel();
+                    }
+                }
+            }
+        }
+        if (approach && approach->pending() && monotonic_us() + ARRIVAL_GUARD_US >= approach->pending()) {
+            // Frame first, then the sensor to confirm the object is there and score the prediction
+            const uint64_t predicted_us = approach->pending();
+            frame = frame_at(camera, predicted_us);
+            distance = read_distance(reading_us);
+            approach->add(reading_us, distance);
+            const double error_ms = approach->score(reading_us, distance);
+            if (frame) {
+                const int64_t frame_delay_us = static_cast<int64_t>(frame->timestamp_us) - static_cast<int64_t>(predicted_us);
+                std::cout << "Predicted arrival: frame " << frame_delay_us / 1000.0 << " ms after it, prediction error "
+                          << error_ms << " ms\n";
+            }
+            if (distance >= 22.0) {
+                // Nothing there after all
+                armed = true;
+                frame.reset();
+            }
         }
+        belt_empty = distance >= 22.0;
     }
-    // std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-    // processing_in_progress = false;
-}
+    // Whatever comes next is a new item, which must not get the last one's cached result
+    if (result_cache && belt_empty) result_cache->newGeneration();
+    if (background && belt_empty) {
+        // Nothing under the sensor: the newest frame is empty belt
+        if (FramePtr empty = camera.latest()) {
+            auto start = std::chrono::steady_clock::now();
+            background->learn(*empty);
+            pipeline_stats.background_latency.record(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+    if (motion_trigger && !frame) return false;
+    if (!motion_trigger && !bench_items && ((distance >= 20.0 && !frame) || (!armed && !serial_mode))) return false;
 
-std::string run_python_script(const std::string& image_file) {
-    std::string cmd = "/home/abhirathkoushik/RTES_files/RTES_final_project/myenv/bin/python3 predict_tflite.py " + image_file;
-    std::string result;
-    char buffer[256];
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-    if (!pipe) return "";
-    while (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-        result += buffer;
+    // Back-pressure from the gates as well as the earlier stages, so an item
+    // never waits behind more than PIPELINE_DEPTH others. Stay armed and try
+    // again next period rather than lose it.
+    ItemPtr item = actuator.outstanding() < PIPELINE_DEPTH ? item_pool->acquire() : nullptr;
+    if (!item) {
+        pipeline_stats.stalls++;
+        if (motion_trigger) held = std::move(frame);
+        return false;
+    }
+    if (!frame) frame = camera.capture();
+    if (!frame) {
+        std::cerr << "Failed to capture frame\n";
+        return false;
+    }
+
+    armed = false;
+    item->id = next_item_id++;
+    item->trigger_us = monotonic_us();
+    item->distance_cm = distance;
+    item->frame = frame;
+    if (result_cache) item->generation = result_cache->generation();
+    item->roi = frame->bounds();
+    if (background) {
+        auto start = std::chrono::steady_clock::now();
+        item->roi = background->detect(*frame);
+        pipeline_stats.background_latency.record(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        if (item->roi.width < frame->width || item->roi.height < frame->height) {
+            pipeline_stats.cropped++;
+            pipeline_stats.crop_area += double(item->roi.width) * item->roi.height / (double(frame->width) * frame->height);
+        }
     }
-    return result;
+    if (capture_log)
+        item->log_record = capture_log->append(*frame, distance, gas_voltage.load(std::memory_order_relaxed));
+    if (SAVE_CAPTURES) saveFrame(*frame, saved_image_path);
+
+    if (pipeline_stats.triggered++ == 0) pipeline_stats.first_trigger_us = item->trigger_us;
+    std::cout << "Captured item " << item->id << " (frame " << frame->sequence << ")";
+    if (item->roi.width < frame->width || item->roi.height < frame->height)
+        std::cout << ", object at " << item->roi.width << "x" << item->roi.height << "+" << item->roi.x << "+" << item->roi.y;
+    std::cout << "\n";
+    // The queue holds as many items as the pool, so this can't fail
+    to_preprocess.tryPush(std::move(item));
+    return true;
 }
 
-std::string extract_json_field(const std::string& json, const std::string& key) {
-    size_t pos = json.find("\"" + key + "\"");
-    if (pos == std::string::npos) return "";
-    pos = json.find(":", pos);
-    size_t start = json.find_first_not_of(" \":", pos);
-    size_t end = json.find_first_of(",}", start);
-    std::string field = json.substr(start, end - start);
-    field.erase(remove(field.begin(), field.end(), '"'), field.end());
-    return field;
+// Stage 2: raw frame -> model input tensor, unless the result cache or the
+// pre-classifier has already settled the item. Items wait in the queues
+// while the emergency stop is active and carry on once it clears.
+bool preprocess_stage(Classifier& classifier) {
+    // Only this stage's thread uses it; the inference stage has its own
+    static YuyvPreprocessor preprocessor(classifier.inputWidth(), classifier.inputHeight());
+    bool queued = false;
+    ItemPtr item;
+    while (!emergency->tripped() && to_preprocess.tryPop(item)) {
+        item->frame_us = item->frame->timestamp_us;
+        if (result_cache) {
+            const Frame& frame = *item->frame;
+            item->frame_hash = ResultCache::hash(frame.yuyv(item->roi), item->roi.width, item->roi.height, frame.stride());
+            ClassificationResult cached;
+            if (result_cache->lookup(item->frame_hash, item->generation, monotonic_us(), cached)) {
+                item->result.wasteClass = cached.wasteClass;
+                item->result.confidence = cached.confidence;
+                item->result.cached = true;
+            }
+        }
+        if (prefilter && !item->result.cached) {
+            prefilter->classify(*item->frame, item->roi, item->result);
+            pipeline_stats.prefilter_latency.record(item->result.prefilterTimeMs);
+        }
+        if (!item->result.prefiltered && !item->result.cached)
+            item->result.preprocessTimeMs = classifier.preprocess(preprocessor, *item->frame, item->roi, item->tensor.data());
+        item->frame.reset();
+        queued |= to_inference.tryPush(std::move(item));
+    }
+    return queued;
 }
 
-void inference_service() {
-    if (!frame_ready) return;
+// Classifies frames streamed after the item's last one until the vote is
+// confident enough, the frame budget is used up or the deadline has passed.
+// The first frame's output must still be in the classifier.
+void classify_more_frames(Classifier& classifier, Camera& camera, PipelineItem& item) {
+    static FrameVote vote(classifier.numClasses());
+    static YuyvPreprocessor preprocessor(classifier.inputWidth(), classifier.inputHeight());
+    vote.reset();
+    vote.add(classifier.probabilities());
 
-    {
-        std::lock_guard<std::mutex> lock(frame_mutex);
-        frame_ready = false;
+    ClassificationResult& result = item.result;
+    StreamingRing* ring = camera.streamingRing();
+    const uint64_t deadline_us = item.trigger_us + static_cast<uint64_t>(early_exit.deadline_ms * 1000.0);
+    while (ring && vote.confidence() < early_exit.confidence
+           && static_cast<int>(vote.frames()) < early_exit.max_frames && !emergency->tripped()) {
+        const uint64_t now = monotonic_us();
+        if (now >= deadline_us) break;
+        FramePtr frame = ring->waitNewer(item.frame_us, std::chrono::milliseconds((deadline_us - now + 999) / 1000));
+        if (!frame) break;
+        item.frame_us = frame->timestamp_us;
+        // Whole frames, like the first one: there is no vote with --roi
+        result.preprocessTimeMs += classifier.preprocess(preprocessor, *frame, item.tensor.data());
+        result.invokeTimeMs += classifier.classifyTensor(item.tensor.data()).invokeTimeMs;
+        vote.add(classifier.probabilities());
     }
 
-    auto start = std::chrono::high_resolution_clock::now();
-    std::string output = run_python_script(saved_image_path);
-    if (!output.empty()) {
-        std::string detected_class = extract_json_field(output, "class");
-        std::string confidence = extract_json_field(output, "confidence");
-        std::string inference_time = extract_json_field(output, "inference_time_ms");
-        if (detected_class == "biodegradable") sweep_servo_1();
-        else if (detected_class == "nonbiodegradable") sweep_servo_2();
-        else std::cout << "Unknown detection result!\n";
+    result.wasteClass = classifier.label(vote.top());
+    result.confidence = vote.confidence();
+    result.frames = static_cast<int>(vote.frames());
+    if (result.confidence >= early_exit.confidence && result.frames < early_exit.max_frames)
+        pipeline_stats.early_exits++;
+}
+
+// Stage 3: run the model and hand the item to the actuator (stage 4)
+void inference_stage(Classifier& classifier, Camera& camera, ServoActuator& actuator) {
+    ItemPtr item;
+    while (!emergency->tripped() && to_inference.tryPop(item)) {
+        if (item->result.prefiltered) {
+            pipeline_stats.prefiltered++;
+        } else if (!item->result.cached) {
+            const double preprocess_ms = item->result.preprocessTimeMs;
+            const double prefilter_ms = item->result.prefilterTimeMs;
+            item->result = classifier.classifyTensor(item->tensor.data());
+            item->result.preprocessTimeMs = preprocess_ms;
+            item->result.prefilterTimeMs = prefilter_ms;
+            if (early_exit.max_frames > 1) classify_more_frames(classifier, camera, *item);
+            pipeline_stats.mobilenet_latency.record(item->result.preprocessTimeMs + item->result.invokeTimeMs);
+        }
+        const ClassificationResult& result = item->result;
+        pipeline_stats.classified++;
+        pipeline_stats.frames_classified += result.frames;
+        if (capture_log) capture_log->setResult(item->log_record, result);
+        if (result_cache && !result.cached && result.wasteClass != WasteClass::UNKNOWN)
+            result_cache->insert(item->frame_hash, item->generation, monotonic_us(), result);
 
-        std::cout << "Detected Class   : " << detected_class << "\n";
-        std::cout << "Confidence       : " << confidence << "\n";
-        std::cout << "Inference Time   : " << inference_time << " ms\n";
+        if (result.wasteClass == WasteClass::UNKNOWN) {
+            std::cout << "Unknown detection result!\n";
+            finish_item();
+        } else if (!actuator.submit({item->id, item->trigger_us, result.wasteClass})) {
+            std::cerr << (actuator.halted() ? "Emergency stop" : "Actuator queue full")
+                      << ", item " << item->id << " not sorted\n";
+            finish_item();
+        }
 
-        processing_in_progress = false;
+        std::cout << "Item " << item->id << "\n";
+        std::cout << "Detected Class   : " << toString(result.wasteClass) << "\n";
+        std::cout << "Confidence       : " << result.confidence << " (" << result.frames << " frames)\n";
+        if (result.cached)
+            std::cout << "Result           : cached (same scene as a recent item)\n";
+        else if (prefilter)
+            std::cout << "Pre-classifier   : " << result.prefilterTimeMs << " ms"
+                      << (result.prefiltered ? ", decided" : ", passed on to MobileNet") << "\n";
+        std::cout << "Preprocess Time  : " << result.preprocessTimeMs << " ms\n";
+        std::cout << "Inference Time   : " << result.invokeTimeMs << " ms\n";
+        std::cout << "Trigger to Result: " << (monotonic_us() - item->trigger_us) / 1000.0 << " ms\n";
     }
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    std::cout << "Time taken for Inference: " << duration_ms << " ms\n";
 }
 
-int main() {
+int main(int argc, char** argv) {
     signal(SIGINT, signalHandler);
-    wiringPiSetup();
-    pinMode(MOSFET_WPI_PIN, OUTPUT);
-    pinMode(TRIG_PIN, OUTPUT);
-    pinMode(ECHO_PIN, INPUT);
-    digitalWrite(MOSFET_WPI_PIN, LOW);
-    digitalWrite(TRIG_PIN, LOW);
 
-    init_servos();
-    set_servo2_initial();
-    set_servo1_initial();
+    // ./sequencer_system [--replay <jpeg directory | raw YUYV file | capture log>]
+    //                   [--fps <replay rate, 0 = unthrottled>] [--log <capture log to write>]
+    //                   [--timers (release with POSIX timers instead of the dispatcher)]
+    //                   [--stats <JSON lines file for the periodic service statistics>]
+    //                   [--serial (one item at a time)] [--bench <items to push through, then stop>]
+    //                   [--sim (simulated GPIO, servos, ultrasonic and gas sensor; always on with make SIM=1;
+    //                           replays the sample images without --replay)]
+    //                   [--sim-gas <schedule file>] [--sim-distance <schedule file>]
+    //                   [--gas-filter <ma:<window> | ema:<alpha>>] [--gas-decimation <samples per output>]
+    //                   [--frames <max frames per item; 1 with --roi>] [--exit-confidence <0..1>] [--frame-deadline <ms after trigger>]
+    //                   [--model <.tflite, float32 or full-integer quantized>]
+    //                   [--prefilter <pre-classifier weights>] [--prefilter-confidence <0..1>]
+    //                   [--cache-distance <max differing hash bits>] [--cache-age <ms an entry stays valid>]
+    //                   [--roi (crop to the object using a background model)] [--roi-threshold <luma difference>]
+    //                   [--trigger <ultrasonic | vision>] [--trigger-zone <x,y,width,height in pixels>]
+    //                   [--motion-level <mean luma change>] [--presence-level <mean luma difference from the empty belt>]
+    //                   [--predict-arrival (capture at the arrival predicted from the approach speed)]
+    //                   [--approach-readings <ultrasonic readings fitted>]
+    std::string replay_path, log_path, stats_path = "service_stats.jsonl";
+    std::string model_path = "model_new_kaggle_dataset.tflite";
+    std::string prefilter_path;
+    float prefilter_confidence = 0.95f;
+    ResultCacheSettings cache_settings;
+    bool use_cache = false;
+    BackgroundSettings background_settings;
+    bool use_background = false;
+    MotionSettings motion_settings;
+    bool vision_trigger = false;
+    ApproachSettings approach_settings;
+    bool predict_arrival = false;
+    double replay_fps = 30.0;
+    ReleaseMode release_mode = ReleaseMode::Dispatcher;
+    bool simulate = false;
+    SimulationScript script;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--timers") release_mode = ReleaseMode::PosixTimers;
+        else if (arg == "--replay" && i + 1 < argc) replay_path = argv[++i];
+        else if (arg == "--fps" && i + 1 < argc) replay_fps = std::atof(argv[++i]);
+        else if (arg == "--log" && i + 1 < argc) log_path = argv[++i];
+        else if (arg == "--stats" && i + 1 < argc) stats_path = argv[++i];
+        else if (arg == "--serial") serial_mode = true;
+        else if (arg == "--bench" && i + 1 < argc) bench_items = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--sim") simulate = true;
+        else if (arg == "--sim-gas" && i + 1 < argc) script.gas_voltage = Schedule::load(argv[++i]);
+        else if (arg == "--sim-distance" && i + 1 < argc) script.distance_cm = Schedule::load(argv[++i]);
+        else if (arg == "--gas-filter" && i + 1 < argc) {
+            std::string filter = argv[++i];
+            if (filter.rfind("ma:", 0) == 0) {
+                gas_filter_settings.type = FilterSettings::MOVING_AVERAGE;
+                gas_filter_settings.window = std::max(1, std::atoi(filter.c_str() + 3));
+            } else if (filter.rfind("ema:", 0) == 0) {
+                gas_filter_settings.type = FilterSettings::EMA;
+                gas_filter_settings.alpha = std::atof(filter.c_str() + 4);
+            } else {
+                std::cerr << "Unknown gas filter " << filter << "\n";
+            }
+        }
+        else if (arg == "--gas-decimation" && i + 1 < argc) gas_filter_settings.decimation = std::atoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) early_exit.max_frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--exit-confidence" && i + 1 < argc) early_exit.confidence = std::atof(argv[++i]);
+        else if (arg == "--frame-deadline" && i + 1 < argc) early_exit.deadline_ms = std::atof(argv[++i]);
+        else if (arg == "--model" && i + 1 < argc) model_path = argv[++i];
+        else if (arg == "--prefilter" && i + 1 < argc) prefilter_path = argv[++i];
+        else if (arg == "--prefilter-confidence" && i + 1 < argc) prefilter_confidence = std::atof(argv[++i]);
+        else if (arg == "--cache-distance" && i + 1 < argc) {
+            cache_settings.max_distance = std::atoi(argv[++i]);
+            use_cache = true;
+        }
+        else if (arg == "--cache-age" && i + 1 < argc) cache_settings.max_age_ms = std::atof(argv[++i]);
+        else if (arg == "--roi") use_background = true;
+        else if (arg == "--roi-threshold" && i + 1 < argc) background_settings.threshold = std::atoi(argv[++i]);
+        else if (arg == "--trigger" && i + 1 < argc) {
+            std::string trigger = argv[++i];
+            if (trigger == "vision") vision_trigger = true;
+            else if (trigger != "ultrasonic") std::cerr << "Unknown trigger " << trigger << "\n";
+        }
+        else if (arg == "--trigger-zone" && i + 1 < argc) {
+            Roi& zone = motion_settings.zone;
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d", &zone.x, &zone.y, &zone.width, &zone.height) != 4) {
+                std::cerr << "Trigger zone must be x,y,width,height\n";
+                zone = Roi();
+            }
+        }
+        else if (arg == "--motion-level" && i + 1 < argc) motion_settings.motion_level = std::atof(argv[++i]);
+        else if (arg == "--presence-level" && i + 1 < argc) motion_settings.presence_level = std::atof(argv[++i]);
+        else if (arg == "--predict-arrival") predict_arrival = true;
+        else if (arg == "--approach-readings" && i + 1 < argc)
+            approach_settings.history = std::max(2, std::atoi(argv[++i]));
+        else std::cerr << "Ignoring unknown option " << arg << "\n";
+    }
+
+#ifdef HAL_SIM_ONLY
+    simulate = true;
+#endif
+    // The crop comes from the trigger frame alone; the object can be
+    // anywhere in a later one, so a vote would mix a cropped first frame
+    // with whole ones
+    if (use_background && early_exit.max_frames > 1) {
+        std::cerr << "--frames is ignored with --roi: each item is classified on its cropped trigger frame\n";
+        early_exit.max_frames = 1;
+    }
+    // A simulated run has no camera either: without --replay it replays the
+    // sample images that come with the training scripts
+    if (replay_path.empty() && simulate) {
+        if (!std::filesystem::is_directory(SIM_SAMPLE_IMAGES)) {
+            std::cerr << "No camera in simulation and no sample images at " << SIM_SAMPLE_IMAGES
+                      << "; pass --replay <jpeg directory | raw YUYV file | capture log>\n";
+            return 1;
+        }
+        replay_path = SIM_SAMPLE_IMAGES;
+    }
+
+#ifndef HAL_SIM_ONLY
+    if (!simulate)
+        hardware = raspberryPiHardware();
+    else
+#endif
+        hardware = simulatedHardware(script);
+    ranger = std::make_unique<UltrasonicRanger>(std::move(hardware.ultrasonic));
 
-    PersistentV4L2Camera camera("/dev/video0");
+    EmergencySettings emergency_settings;
+    emergency_settings.filter = gas_filter_settings;
+    emergency = std::make_unique<EmergencyStop>(*hardware.mosfet, emergency_settings);
+    gas_samples.watch([](const Sample& sample) { emergency->process(sample); });
 
-    Sequencer seq;
-    seq.addService("Gas Monitor", gas_service, 1, 99, 100);
-    seq.addService("Camera + Distance", [&camera]() { capture_frames(camera); }, 1, 98, 200);
-    seq.addService("Inference", inference_service, 2, 99, 300);
+    if (!log_path.empty())
+        capture_log = std::make_unique<CaptureLogWriter>(log_path, CAPTURE_LOG_CAPACITY);
+
+    std::unique_ptr<Camera> camera;
+    if (!replay_path.empty()) {
+        camera = ReplayCamera::open(replay_path, replay_fps);
+    } else {
+        // Keep 4 driver buffers streaming so a trigger gets the newest exposure
+        camera = std::make_unique<PersistentV4L2Camera>("/dev/video0", 640, 480, 4);
+    }
+    camera->startStreaming(3, 90);
+    Classifier classifier(model_path, "labels.txt");
+    if (!prefilter_path.empty())
+        prefilter = std::make_unique<ColorPrefilter>(prefilter_path, prefilter_confidence);
+    if (use_cache) result_cache = std::make_unique<ResultCache>(cache_settings);
+    if (use_background) background = std::make_unique<BackgroundModel>(background_settings);
+    if (vision_trigger) motion_trigger = std::make_unique<MotionTrigger>(motion_settings);
+    if (predict_arrival && !vision_trigger) approach = std::make_unique<ApproachPredictor>(approach_settings);
+    item_pool = std::make_unique<PipelineItemPool>(PIPELINE_DEPTH, classifier.inputBytes());
+
+    // Both gates are driven from one thread on core 3, next to the camera ring
+    ServoActuator actuator(*hardware.servo1, *hardware.servo2);
+    actuator.onEvent([](const SortEvent& event) {
+        if (event.phase == SortEvent::Aborted) {
+            finish_item();
+            std::cout << "Emergency stop: item " << event.command.id << " not sorted\n";
+            return;
+        }
+        if (event.phase != SortEvent::Completed) return;
+        finish_item();
+        std::cout << "Sorted item " << event.command.id << " (" << toString(event.command.target) << "): "
+                  << (event.started_us - event.queued_us) / 1000.0 << " ms queued, "
+                  << (event.at_us - event.started_us) / 1000.0 << " ms moving, "
+                  << (event.at_us - event.command.timestamp_us) / 1000.0 << " ms since trigger\n";
+    });
+    actuator.start(3, 80);
+    emergency->onTrip([&actuator] { actuator.halt(); });
+    emergency->onReset([&actuator] { actuator.resume(); });
+
+    // Release dispatcher pinned to core 0, away from the service cores
+    Sequencer seq(release_mode, 0, 99);
+    // Periodic loops skip releases missed during a stall instead of bursting afterwards
+    seq.addService("Gas Monitor", gas_service, 1, 99, 100, OverrunPolicy::Skip);
+    // Each pipeline stage is released by the one before it and drains its
+    // whole input queue, so one pending release is always enough. Stages
+    // are added consumer first because each one's job holds a reference to
+    // the next; stopServices() stops every service taking releases and
+    // joins all of them before any is torn down, so the order is safe at
+    // shutdown too.
+    Service& inference = seq.addEventService("Inference", [&classifier, &camera, &actuator]() {
+        inference_stage(classifier, *camera, actuator);
+    }, 2, 99, OverrunPolicy::Coalesce);
+    Service& preprocess = seq.addEventService("Preprocess", [&classifier, &inference]() {
+        if (preprocess_stage(classifier)) inference.release();
+    }, 1, 97, OverrunPolicy::Coalesce);
+    Service& capture = seq.addService("Camera + Distance", [&camera, &actuator, &preprocess, &inference]() {
+        // Restart the stages that held items during an emergency stop
+        static bool paused = false;
+        if (paused && !emergency->tripped()) {
+            preprocess.release();
+            inference.release();
+        }
+        paused = emergency->tripped();
+        if (capture_stage(*camera, actuator)) preprocess.release();
+    }, 1, 98, CAPTURE_PERIOD_MS, OverrunPolicy::Skip);
+    if (approach) arrival_release = &seq.addScheduledRelease(capture);
+
+    // The vision trigger runs on the camera's core at every frame and
+    // releases the capture service as soon as an object has settled
+    if (motion_trigger && camera->streamingRing()) {
+        motion_trigger->onTrigger([&capture](const FramePtr& frame) {
+            triggered_frames.publish(frame);
+            capture.releaseExtra();
+        });
+        motion_trigger->start(*camera->streamingRing(), 3, 85);
+    }
 
     seq.startServices();
     std::cout << "Press Ctrl+C to stop...\n";
 
-    while (keepRunning.load()) {
+    // Dump the service latency histograms every 5 s while running
+    std::ofstream stats_file(stats_path, std::ios::app);
+    auto next_dump = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (keepRunning.load() && !(bench_items && pipeline_stats.finished >= bench_items)) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (stats_file && std::chrono::steady_clock::now() >= next_dump) {
+            seq.dumpStatistics(stats_file);
+            auto now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+            stats_file << std::fixed << "{\"time\":" << now << ",\"emergency_stops\":" << emergency->trips()
+                       << ",\"sample_to_cutoff\":";
+            writeJson(stats_file, emergency->cutoffLatency());
+            if (result_cache)
+                stats_file << ",\"cache_hits\":" << result_cache->hits() << ",\"cache_misses\":" << result_cache->misses();
+            if (approach) {
+                stats_file << ",\"arrival_predictions\":" << approach->predictions() << ",\"arrival_error\":";
+                writeJson(stats_file, approach->error());
+            }
+            stats_file << "}\n" << std::defaultfloat << std::flush;
+            next_dump += std::chrono::seconds(5);
+        }
     }
 
+    // Threads outside the Sequencer that release its services stop first
+    if (motion_trigger) motion_trigger->stop();
     seq.stopServices();
+    hardware.gas->stop();
+    actuator.stop();
+    std::cout << "Gas samples dropped (ring full): " << gas_samples.overruns() << "\n";
+    std::cout << "Ultrasonic pings: " << ranger->pings() << ", timeouts: " << ranger->timeouts() << "\n";
+    std::cout << "Items sorted: " << actuator.completedCount() << ", rejected: " << actuator.rejectedCount()
+              << ", aborted: " << actuator.abortedCount() << "\n";
+    if (emergency->trips() > 0) {
+        HistogramSnapshot cutoff = emergency->cutoffLatency();
+        std::cout << "Emergency stops: " << emergency->trips() << ", sample to cutoff: mean "
+                  << cutoff.meanMs() << " ms, max " << cutoff.maxUs / 1000.0 << " ms\n";
+    }
+    uint64_t finished = pipeline_stats.finished, last_finish_us = pipeline_stats.last_finish_us;
+    if (finished > 0 && last_finish_us > pipeline_stats.first_trigger_us) {
+        double minutes = (last_finish_us - pipeline_stats.first_trigger_us) / 60e6;
+        std::cout << (serial_mode ? "Serial" : "Pipelined") << " throughput: " << finished / minutes
+                  << " items/min (" << finished << " items, " << pipeline_stats.stalls << " pipeline stalls)\n";
+    }
+    if (early_exit.max_frames > 1 && pipeline_stats.classified > 0) {
+        std::cout << "Frames per item: " << double(pipeline_stats.frames_classified) / pipeline_stats.classified
+                  << " (up to " << early_exit.max_frames << "), " << pipeline_stats.early_exits << " of "
+                  << pipeline_stats.classified << " items confident early\n";
+    }
+    if (prefilter && pipeline_stats.classified > 0) {
+        // Saving per decided item estimated from the items that did go through MobileNet
+        const uint64_t classified = pipeline_stats.classified, decided = pipeline_stats.prefiltered;
+        const HistogramSnapshot cost = pipeline_stats.prefilter_latency.snapshot();
+        const HistogramSnapshot full = pipeline_stats.mobilenet_latency.snapshot();
+        std::cout << "Pre-classifier: " << decided << " of " << classified << " items decided early ("
+                  << 100.0 * decided / classified << "%), " << cost.meanMs() << " ms per item";
+        if (full.count > 0) {
+            const double saved = double(decided) / classified * full.meanMs() - cost.meanMs();
+            std::cout << ", MobileNet " << full.meanMs() << " ms per item, mean saving "
+                      << saved << " ms per item";
+        }
+        std::cout << "\n";
+    }
+    if (motion_trigger) {
+        const HistogramSnapshot settle = motion_trigger->settleTime(), cost = motion_trigger->frameCost();
+        std::cout << "Vision trigger: " << motion_trigger->triggers() << " triggers ("
+                  << motion_trigger->forcedTriggers() << " still moving) over " << motion_trigger->frames()
+                  << " frames, arrival to capture " << settle.meanMs() << " ms mean, "
+                  << cost.meanMs() * 1000.0 << " us mean / " << cost.maxUs << " us max per frame\n";
+    }
+    if (approach) {
+        const HistogramSnapshot error = approach->error(), lead = pipeline_stats.arrival_lead.snapshot();
+        std::cout << "Arrival prediction: " << lead.count << " captures scheduled ahead of the capture period ("
+                  << lead.meanMs() << " ms earlier on average), " << approach->scored() << " scored, error "
+                  << error.meanMs() << " ms mean |error|, " << approach->meanErrorMs() << " ms mean bias, "
+                  << error.maxUs / 1000.0 << " ms max\n";
+    }
+    if (background) {
+        const HistogramSnapshot cost = pipeline_stats.background_latency.snapshot();
+        const uint64_t cropped = pipeline_stats.cropped;
+        std::cout << "Background ROI: " << cropped << " of " << pipeline_stats.triggered << " items cropped";
+        if (cropped > 0) std::cout << " to " << 100.0 * pipeline_stats.crop_area / cropped << "% of the frame on average";
+        std::cout << ", learn/detect " << cost.meanMs() << " ms mean, " << cost.maxUs / 1000.0
+                  << " ms max per capture period\n";
+    }
+    if (result_cache) {
+        const uint64_t hits = result_cache->hits(), lookups = hits + result_cache->misses();
+        std::cout << "Result cache: " << hits << " hits, " << lookups - hits << " misses";
+        if (lookups > 0) std::cout << " (" << 100.0 * hits / lookups << "% hit rate)";
+        std::cout << "\n";
+    }
+    if (StreamingRing* ring = camera->streamingRing()) {
+        std::cout << "Camera frames received: " << ring->framesReceived()
+                  << ", dropped: " << ring->framesDropped() << "\n";
+    }
+    if (capture_log) {
+        std::cout << "Capture log records: " << capture_log->recordCount() << "\n";
+        capture_log.reset();
+    }
     std::cout << "System shutdown complete.\n";
     return 0;
 }
@@ -0,0 +1,118 @@
+// frame.hpp
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Rectangle of a frame in pixels. x and width are even, so it starts
+// and ends on a whole YUYV pixel pair.
+struct Roi {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+};
+
+/**
+ * One raw YUYV camera frame. Frames are handed between services as
+ * ref-counted FramePtr objects so nothing has to touch the disk.
+ **/
+struct Frame {
+    int width = 0;
+    int height = 0;
+    uint32_t sequence = 0;
+    uint64_t timestamp_us = 0;   // V4L2 buffer timestamp (CLOCK_MONOTONIC)
+    size_t bytesused = 0;
+    std::vector<uint8_t> data;   // packed YUYV, 2 bytes per pixel
+
+    const uint8_t* yuyv() const { return data.data(); }
+    size_t stride() const { return static_cast<size_t>(width) * 2; }
+
+    Roi bounds() const { return {0, 0, width, height}; }
+
+    // First byte of a region; rows keep the frame's stride
+    const uint8_t* yuyv(const Roi& roi) const {
+        return data.data() + static_cast<size_t>(roi.y) * stride() + static_cast<size_t>(roi.x) * 2;
+    }
+
+    // Wraps the YUYV data as a cv::Mat without copying
+    cv::Mat yuyvMat() const {
+        return cv::Mat(height, width, CV_8UC2, const_cast<uint8_t*>(data.data()));
+    }
+};
+
+using FramePtr = std::shared_ptr<const Frame>;
+
+/**
+ * Fixed pool of preallocated frame buffers. acquire() hands out a
+ * frame whose deleter puts the buffer back into the pool, so the
+ * capture path never allocates once the pool is warm.
+ **/
+class FramePool {
+public:
+    FramePool(size_t count, size_t bytes) : state(std::make_shared<State>()) {
+        for (size_t i = 0; i < count; ++i) {
+            auto frame = std::make_unique<Frame>();
+            frame->data.resize(bytes);
+            state->free.push_back(std::move(frame));
+        }
+    }
+
+    // Returns nullptr if every frame is still referenced somewhere
+    std::shared_ptr<Frame> acquire() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->free.empty()) return nullptr;
+        Frame* frame = state->free.back().release();
+        state->free.pop_back();
+        std::shared_ptr<State> owner = state;
+        return std::shared_ptr<Frame>(frame, [owner](Frame* f) {
+            std::lock_guard<std::mutex> lock(owner->mutex);
+            owner->free.emplace_back(f);
+        });
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Frame>> free;
+    };
+    std::shared_ptr<State> state;
+};
+
+/**
+ * Single-slot mailbox between the capture and inference services.
+ * A newer frame replaces one that hasn't been taken yet.
+ **/
+class FrameHandoff {
+public:
+    void publish(FramePtr frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(frame);
+    }
+
+    // Non-blocking, returns nullptr if there is no new frame
+    FramePtr take() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::move(pending);
+    }
+
+private:
+    std::mutex mutex;
+    FramePtr pending;
+};
+
+// Optional disk copy of a frame for debugging, off the inference path
+inline bool saveFrame(const Frame& frame, const std::string& filename) {
+    cv::Mat bgr;
+    cv::cvtColor(frame.yuyvMat(), bgr, cv::COLOR_YUV2BGR_YUYV);
+    return cv::imwrite(filename, bgr);
+}
+
+#endif // FRAME_HPP
@@ -0,0 +1,89 @@
+// hal.hpp
+#ifndef HAL_HPP
+#define HAL_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sample_ring.hpp"
+#include "ultrasonic.hpp"
+
+/**
+ * Thin device interfaces between the application and the Raspberry
+ * Pi peripherals, so the same binary can run against simulated
+ * hardware. The real backends (wiringPi, softPwm, libgpiod, I2C) are
+ * in hal_rpi.cpp, the simulated ones in hal_sim.cpp. Cameras already
+ * have their own interface (camera.hpp): PersistentV4L2Camera and
+ * ReplayCamera.
+ **/
+
+// On/off GPIO output, e.g. the MOSFET that cuts the supply
+class DigitalOutput {
+public:
+    virtual ~DigitalOutput() = default;
+    virtual void write(bool high) = 0;
+};
+
+// Servo PWM in softPwm units: 0..200 x 100 us per 20 ms period, 0 = no pulses
+class PwmOutput {
+public:
+    virtual ~PwmOutput() = default;
+    virtual void write(int value) = 0;
+};
+
+// Free-running ADC channel that pushes every timestamped sample (in volts) into a ring
+class SampleSource {
+public:
+    virtual ~SampleSource() = default;
+    virtual void start(SampleRing& ring) = 0;
+    virtual void stop() = 0;
+};
+
+struct Hardware {
+    std::unique_ptr<DigitalOutput> mosfet;
+    std::unique_ptr<PwmOutput> servo1;   // biodegradable gate
+    std::unique_ptr<PwmOutput> servo2;   // non-biodegradable gate
+    std::unique_ptr<EchoLine> ultrasonic;
+    std::unique_ptr<SampleSource> gas;   // MQ-7 through the ADS1115
+};
+
+/**
+ * Piecewise-constant value over time for the simulated sensors,
+ * loaded from a text file with one "<seconds> <value>" pair per line
+ * ('#' starts a comment). The value holds until the next line's time;
+ * the schedule repeats after the last line's time.
+ **/
+class Schedule {
+public:
+    Schedule(std::vector<std::pair<double, float>> points = {}) : points(std::move(points)) {}
+
+    static Schedule load(const std::string& path);
+
+    float at(uint64_t elapsed_us) const;
+
+private:
+    std::vector<std::pair<double, float>> points;
+};
+
+struct SimulationScript {
+    // Gas sensor voltage; the default stays below the 1.9 V alarm
+    Schedule gas_voltage{{{0.0, 0.8f}, {60.0, 0.8f}}};
+
+    // Ultrasonic distance in cm; by default an item arrives every 3 s and stays 1 s
+    Schedule distance_cm{{{0.0, 10.0f}, {1.0, 60.0f}, {3.0, 60.0f}}};
+
+    // Servo and MOSFET writes are printed when set
+    bool log_outputs = true;
+};
+
+Hardware simulatedHardware(const SimulationScript& script = SimulationScript());
+
+// make SIM=1 leaves the Pi libraries out of the build, so only the simulation exists
+#ifndef HAL_SIM_ONLY
+Hardware raspberryPiHardware();
+#endif
+
+#endif // HAL_HPP
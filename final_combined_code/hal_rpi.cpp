@@ -0,0 +1,135 @@
+#include "hal.hpp"
+#include <stdexcept>
+#include <time.h>
+#include <gpiod.h>
+#include <softPwm.h>
+#include <wiringPi.h>
+#include "ads1115rpi.h"
+#include "servo.hpp"
+
+#define MOSFET_WPI_PIN 6
+#define TRIG_GPIO 23  // wiringPi pin 4
+#define ECHO_GPIO 24  // wiringPi pin 5
+
+namespace {
+
+class WiringPiOutput : public DigitalOutput {
+public:
+    explicit WiringPiOutput(int pin) : pin(pin) {
+        pinMode(pin, OUTPUT);
+        digitalWrite(pin, LOW);
+    }
+
+    void write(bool high) override { digitalWrite(pin, high ? HIGH : LOW); }
+
+private:
+    const int pin;
+};
+
+class SoftPwmOutput : public PwmOutput {
+public:
+    explicit SoftPwmOutput(int pin) : pin(pin) {
+        if (softPwmCreate(pin, 0, 200) != 0)
+            throw std::runtime_error("Failed to initialize servo on wiringPi pin " + std::to_string(pin));
+    }
+
+    void write(int value) override { softPwmWrite(pin, value); }
+
+private:
+    const int pin;
+};
+
+/**
+ * The HC-SR04 through libgpiod: TRIG as an output line, ECHO as an
+ * input with edge events, so the echo pulse is timed by the kernel's
+ * interrupt timestamps instead of by polling. GPIO numbers are BCM
+ * offsets on the chip.
+ **/
+class GpiodEchoLine : public EchoLine {
+public:
+    GpiodEchoLine(unsigned trig_gpio, unsigned echo_gpio, unsigned chip_number = 0) {
+        chip = gpiod_chip_open_by_number(chip_number);
+        if (!chip) throw std::runtime_error("Could not open GPIO chip for the ultrasonic sensor");
+
+        trig = gpiod_chip_get_line(chip, trig_gpio);
+        echo = gpiod_chip_get_line(chip, echo_gpio);
+        if (!trig || gpiod_line_request_output(trig, "ultrasonic-trig", 0) < 0) {
+            gpiod_chip_close(chip);
+            throw std::runtime_error("Could not request the ultrasonic TRIG line");
+        }
+        if (!echo || gpiod_line_request_both_edges_events(echo, "ultrasonic-echo") < 0) {
+            gpiod_line_release(trig);
+            gpiod_chip_close(chip);
+            throw std::runtime_error("Could not request edge events on the ultrasonic ECHO line");
+        }
+    }
+
+    ~GpiodEchoLine() override {
+        gpiod_line_release(echo);
+        gpiod_line_release(trig);
+        gpiod_chip_close(chip);
+    }
+
+    bool trigger() override {
+        // 10 us start pulse. Too short to sleep for, and the only time spent spinning.
+        if (gpiod_line_set_value(trig, 1) < 0) return false;
+        const uint64_t end = now_ns() + 10000;
+        while (now_ns() < end) {}
+        return gpiod_line_set_value(trig, 0) == 0;
+    }
+
+    bool waitEdge(Edge& edge, uint64_t timeout_us) override {
+        timespec timeout = {static_cast<time_t>(timeout_us / 1000000), static_cast<long>(timeout_us % 1000000) * 1000};
+        if (gpiod_line_event_wait(echo, &timeout) <= 0) return false;
+
+        gpiod_line_event event;
+        if (gpiod_line_event_read(echo, &event) < 0) return false;
+        edge.rising = event.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+        edge.timestamp_ns = event.ts.tv_sec * 1000000000ULL + event.ts.tv_nsec;
+        return true;
+    }
+
+private:
+    gpiod_chip* chip = nullptr;
+    gpiod_line* trig = nullptr;
+    gpiod_line* echo = nullptr;
+
+    static uint64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+};
+
+// MQ-7 on AIN0 of the ADS1115, sampled on its data-ready interrupt
+class Ads1115Source : public SampleSource {
+public:
+    void start(SampleRing& ring) override {
+        ADS1115settings settings;
+        settings.channel = ADS1115settings::AIN0;
+        settings.pgaGain = ADS1115settings::FSR2_048;
+        settings.samplingRate = ADS1115settings::FS860HZ; // Changing sampling rate from 8 samples/sec to 860 samples/sec
+        reader.setSampleRing(&ring);
+        reader.start(settings);
+    }
+
+    void stop() override { reader.stop(); }
+
+private:
+    ADS1115rpi reader;
+};
+
+} // namespace
+
+Hardware raspberryPiHardware()
+{
+    wiringPiSetup();
+
+    Hardware hw;
+    hw.mosfet = std::make_unique<WiringPiOutput>(MOSFET_WPI_PIN);
+    hw.servo1 = std::make_unique<SoftPwmOutput>(SERVO1_GPIO);
+    hw.servo2 = std::make_unique<SoftPwmOutput>(SERVO2_GPIO);
+    hw.ultrasonic = std::make_unique<GpiodEchoLine>(TRIG_GPIO, ECHO_GPIO);
+    hw.gas = std::make_unique<Ads1115Source>();
+    return hw;
+}
@@ -0,0 +1,134 @@
+#include "hal.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <time.h>
+
+static uint64_t now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+Schedule Schedule::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Failed to open schedule " + path);
+
+    std::vector<std::pair<double, float>> points;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        double t;
+        float value;
+        if (fields >> t >> value) points.emplace_back(t, value);
+    }
+    if (points.empty()) throw std::runtime_error("No \"<seconds> <value>\" lines in " + path);
+    return Schedule(std::move(points));
+}
+
+float Schedule::at(uint64_t elapsed_us) const
+{
+    if (points.empty()) return 0.0f;
+    double t = elapsed_us / 1e6;
+    if (points.back().first > 0.0) t = std::fmod(t, points.back().first);
+
+    float value = points.front().second;
+    for (const auto& point : points) {
+        if (point.first > t) break;
+        value = point.second;
+    }
+    return value;
+}
+
+namespace {
+
+class LoggingOutput : public DigitalOutput {
+public:
+    LoggingOutput(std::string name, bool log) : name(std::move(name)), log(log) {}
+
+    void write(bool high) override {
+        if (log && high != state) std::cout << "[sim] " << name << (high ? " on\n" : " off\n");
+        state = high;
+    }
+
+private:
+    const std::string name;
+    const bool log;
+    bool state = false;
+};
+
+// A servo that only reports where it was told to go
+class LoggingPwm : public PwmOutput {
+public:
+    LoggingPwm(std::string name, bool log) : name(std::move(name)), log(log) {}
+
+    void write(int value) override {
+        if (log) std::cout << "[sim] " << name << " pwm " << value << "\n";
+    }
+
+private:
+    const std::string name;
+    const bool log;
+};
+
+// Samples from a schedule at the ADS1115's 860 Hz, on its own thread like the real driver
+class ScriptedSampleSource : public SampleSource {
+public:
+    ScriptedSampleSource(Schedule schedule, double rate_hz = 860.0)
+        : schedule(std::move(schedule)), interval(std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate_hz))) {}
+
+    ~ScriptedSampleSource() override { stop(); }
+
+    void start(SampleRing& ring) override {
+        if (running) return;
+        running = true;
+        thr = std::thread([this, &ring] {
+            const uint64_t start_us = now_us();
+            auto next = std::chrono::steady_clock::now();
+            while (running) {
+                const uint64_t t = now_us();
+                ring.push({t, schedule.at(t - start_us)});
+                next += interval;
+                std::this_thread::sleep_until(next);
+            }
+        });
+    }
+
+    void stop() override {
+        if (!running) return;
+        running = false;
+        thr.join();
+    }
+
+private:
+    const Schedule schedule;
+    const std::chrono::nanoseconds interval;
+    std::atomic<bool> running{false};
+    std::thread thr;
+};
+
+} // namespace
+
+Hardware simulatedHardware(const SimulationScript& script)
+{
+    Hardware hw;
+    hw.mosfet = std::make_unique<LoggingOutput>("MOSFET", script.log_outputs);
+    hw.servo1 = std::make_unique<LoggingPwm>("servo 1", script.log_outputs);
+    hw.servo2 = std::make_unique<LoggingPwm>("servo 2", script.log_outputs);
+
+    const uint64_t start_us = now_us();
+    Schedule distance = script.distance_cm;
+    hw.ultrasonic = std::make_unique<SimulatedEchoLine>([distance, start_us](uint64_t t_us) {
+        return distance.at(t_us - start_us);
+    });
+    hw.gas = std::make_unique<ScriptedSampleSource>(script.gas_voltage);
+    return hw;
+}
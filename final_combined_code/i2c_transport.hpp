@@ -0,0 +1,137 @@
+// i2c_transport.hpp
+#ifndef I2C_TRANSPORT_HPP
+#define I2C_TRANSPORT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * Byte-level access to one I2C slave, so the ADS1115 driver can run
+ * against a mock device. Every call is one kernel entry on the real
+ * bus and is counted, which is what the driver's read modes are
+ * trying to save.
+ **/
+class I2cTransport {
+public:
+    virtual ~I2cTransport() = default;
+
+    // One write transaction of n bytes
+    virtual bool write(const uint8_t* data, size_t n) = 0;
+
+    // One read transaction of n bytes
+    virtual bool read(uint8_t* data, size_t n) = 0;
+
+    // Write then read with a repeated start, as one combined transaction
+    virtual bool writeRead(const uint8_t* out, size_t out_n, uint8_t* in, size_t in_n) = 0;
+
+    uint64_t syscalls() const { return syscall_count.load(std::memory_order_relaxed); }
+
+protected:
+    void counted() { syscall_count.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> syscall_count{0};
+};
+
+// /dev/i2c-N opened by the caller, with I2C_SLAVE already set
+class LinuxI2cTransport : public I2cTransport {
+public:
+    LinuxI2cTransport(int fd, uint16_t address) : fd(fd), address(address) {}
+
+    bool write(const uint8_t* data, size_t n) override {
+        counted();
+        return ::write(fd, data, n) == static_cast<ssize_t>(n);
+    }
+
+    bool read(uint8_t* data, size_t n) override {
+        counted();
+        return ::read(fd, data, n) == static_cast<ssize_t>(n);
+    }
+
+    bool writeRead(const uint8_t* out, size_t out_n, uint8_t* in, size_t in_n) override {
+        i2c_msg msgs[2] = {
+            {address, 0, static_cast<uint16_t>(out_n), const_cast<uint8_t*>(out)},
+            {address, I2C_M_RD, static_cast<uint16_t>(in_n), in},
+        };
+        i2c_rdwr_ioctl_data transfer = {msgs, 2};
+        counted();
+        return ioctl(fd, I2C_RDWR, &transfer) == 2;
+    }
+
+private:
+    const int fd;
+    const uint16_t address;
+};
+
+/**
+ * ADS1115 register file behind a fake bus: writes set the pointer
+ * register (and the register it points to, for 3-byte writes), reads
+ * return the register the pointer is at. convert() stands in for a
+ * finished conversion: the conversion register takes the callback's
+ * value for the input the multiplexer was set to. With enter_kernel
+ * set every call also makes a cheap real syscall, so CPU measurements
+ * include the kernel entry and exit the real bus would cost.
+ **/
+class MockAds1115 : public I2cTransport {
+public:
+    // Raw conversion result for AIN0..AIN3
+    using ConversionFunction = std::function<int16_t(unsigned input)>;
+
+    explicit MockAds1115(ConversionFunction conversion = [](unsigned) { return int16_t(0x4000); }, bool enter_kernel = true)
+        : conversion(std::move(conversion)), enter_kernel(enter_kernel) {}
+
+    bool write(const uint8_t* data, size_t n) override {
+        syscallCost();
+        if (n == 0 || data[0] > 3) return false;
+        pointer = data[0];
+        if (n == 3) regs[pointer] = static_cast<uint16_t>((data[1] << 8) | data[2]);
+        if (n == 3 && pointer == 1) config_writes++;
+        return n == 1 || n == 3;
+    }
+
+    bool read(uint8_t* data, size_t n) override {
+        syscallCost();
+        return fill(data, n);
+    }
+
+    bool writeRead(const uint8_t* out, size_t out_n, uint8_t* in, size_t in_n) override {
+        syscallCost();
+        if (out_n != 1 || out[0] > 3) return false;
+        pointer = out[0];
+        return fill(in, in_n);
+    }
+
+    void convert() { regs[0] = static_cast<uint16_t>(conversion((regs[1] >> 12) & 3)); }
+
+    uint16_t reg(uint8_t r) const { return regs[r & 3]; }
+    uint64_t configWrites() const { return config_writes; }
+
+private:
+    ConversionFunction conversion;
+    const bool enter_kernel;
+    uint16_t regs[4] = {0, 0x8583, 0x8000, 0x7fff};   // power-on defaults
+    uint8_t pointer = 0;
+    uint64_t config_writes = 0;
+
+    void syscallCost() {
+        counted();
+        if (enter_kernel) syscall(SYS_getppid);
+    }
+
+    bool fill(uint8_t* data, size_t n) {
+        if (n != 2) return false;
+        data[0] = regs[pointer] >> 8;
+        data[1] = regs[pointer] & 0xff;
+        return true;
+    }
+};
+
+#endif // I2C_TRANSPORT_HPP
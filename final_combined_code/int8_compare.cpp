@@ -0,0 +1,78 @@
+// Float32 vs full-integer model through the camera preprocessing: every
+// sample image is turned into a 640x480 YUYV frame the way --replay feeds
+// it (replay_camera.hpp) and classified by both models with the fused
+// preprocessor, as the pipeline does. benchmark_int8.py runs the same
+// comparison on PIL-resized float input instead. Built and run by make compare.
+//   ./int8_compare [float model] [int8 model] [image directory]
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "classifier.hpp"
+#include "latency_histogram.hpp"
+#include "replay_camera.hpp"
+
+static void print_times(const char* name, const LatencyHistogram& histogram)
+{
+    const HistogramSnapshot h = histogram.snapshot();
+    std::cout << "  " << name << ": mean " << h.meanMs() << " ms, p50 " << h.percentileMs(0.5)
+              << " ms, p95 " << h.percentileMs(0.95) << " ms\n";
+}
+
+int main(int argc, char** argv)
+{
+    const std::string float_model = argc > 1 ? argv[1] : "model_new_kaggle_dataset.tflite";
+    const std::string int8_model = argc > 2 ? argv[2] : "model_new_kaggle_dataset_int8.tflite";
+    const std::string image_dir = argc > 3 ? argv[3] : "../model_training/kaggle_new_dataset";
+    const int width = 640, height = 480;
+
+    Classifier float_classifier(float_model, "labels.txt");
+    Classifier int8_classifier(int8_model, "labels.txt");
+
+    std::vector<cv::String> files;
+    cv::glob(image_dir + "/*.jpg", files, true);
+    std::sort(files.begin(), files.end());
+
+    Frame frame;
+    frame.width = width;
+    frame.height = height;
+    frame.data.resize(frame.stride() * height);
+
+    LatencyHistogram float_preprocess, float_invoke, int8_preprocess, int8_invoke;
+    size_t images = 0, agree = 0;
+    for (const auto& file : files) {
+        cv::Mat bgr = cv::imread(file, cv::IMREAD_COLOR);
+        if (bgr.empty()) {
+            std::cerr << "Skipping unreadable " << file << "\n";
+            continue;
+        }
+        cv::Mat resized;
+        cv::resize(bgr, resized, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+        bgrToYuyv(resized, frame.data.data());
+
+        const ClassificationResult f = float_classifier.classify(frame);
+        const ClassificationResult q = int8_classifier.classify(frame);
+        float_preprocess.record(f.preprocessTimeMs);
+        float_invoke.record(f.invokeTimeMs);
+        int8_preprocess.record(q.preprocessTimeMs);
+        int8_invoke.record(q.invokeTimeMs);
+
+        const bool same = f.wasteClass == q.wasteClass;
+        agree += same;
+        ++images;
+        std::cout << file << ": float32 " << toString(f.wasteClass) << " (" << f.confidence << ")  int8 "
+                  << toString(q.wasteClass) << " (" << q.confidence << ")" << (same ? "" : "  DIFFERENT") << "\n";
+    }
+    if (images == 0) {
+        std::cerr << "No JPEG images under " << image_dir << "\n";
+        return 1;
+    }
+
+    std::cout << "Images: " << images << ", top-1 agreement: " << 100.0 * agree / images << "%\n";
+    print_times("float32 preprocess", float_preprocess);
+    print_times("float32 invoke    ", float_invoke);
+    print_times("int8 preprocess   ", int8_preprocess);
+    print_times("int8 invoke       ", int8_invoke);
+    return 0;
+}
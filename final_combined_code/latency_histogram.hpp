@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+// Point-in-time copy of a LatencyHistogram, safe to inspect at leisure
+struct HistogramSnapshot
+{
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = 1u << SUB_BITS;
+    static constexpr int MAX_BITS = 40;   // ~12.7 days in microseconds
+    static constexpr size_t BUCKETS = SUB_COUNT + (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t count = 0;
+    uint64_t sumUs = 0;
+    uint64_t minUs = 0;
+    uint64_t maxUs = 0;
+
+    static size_t bucketOf(uint64_t us)
+    {
+        if (us < SUB_COUNT) return us;
+        int msb = 63 - __builtin_clzll(us);
+        if (msb > MAX_BITS) return BUCKETS - 1;
+        int shift = msb - SUB_BITS;
+        return SUB_COUNT + shift * SUB_COUNT + ((us >> shift) - SUB_COUNT);
+    }
+
+    // Midpoint of the values that land in a bucket
+    static double bucketValue(size_t bucket)
+    {
+        if (bucket < SUB_COUNT) return bucket;
+        uint64_t shift = (bucket - SUB_COUNT) / SUB_COUNT;
+        uint64_t sub = (bucket - SUB_COUNT) % SUB_COUNT;
+        uint64_t low = (SUB_COUNT + sub) << shift;
+        uint64_t high = ((SUB_COUNT + sub + 1) << shift) - 1;
+        return (low + high) / 2.0;
+    }
+
+    // Value at quantile q (0..1) in milliseconds, within ~3% of the true value
+    double percentileMs(double q) const
+    {
+        if (count == 0) return 0.0;
+        uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                double us = bucketValue(i);
+                if (us < minUs) us = minUs;
+                if (us > maxUs) us = maxUs;
+                return us / 1000.0;
+            }
+        }
+        return maxUs / 1000.0;
+    }
+
+    double meanMs() const { return count ? sumUs / 1000.0 / count : 0.0; }
+};
+
+// {"count":...,"mean_ms":...,...,"max_ms":...} for the JSON lines statistics
+inline void writeJson(std::ostream& out, const HistogramSnapshot& h)
+{
+    out << "{\"count\":" << h.count
+        << ",\"mean_ms\":" << h.meanMs()
+        << ",\"min_ms\":" << h.minUs / 1000.0
+        << ",\"p50_ms\":" << h.percentileMs(0.5)
+        << ",\"p99_ms\":" << h.percentileMs(0.99)
+        << ",\"p999_ms\":" << h.percentileMs(0.999)
+        << ",\"max_ms\":" << h.maxUs / 1000.0 << "}";
+}
+
+/**
+ * Fixed-memory log-linear (HDR-style) latency histogram with
+ * microsecond resolution: 32 linear sub-buckets per power of two.
+ *
+ * record() is for a single writer thread and never locks; any other
+ * thread can take a snapshot() at any time. Counters are relaxed
+ * atomics, so a snapshot taken mid-record may be off by one sample.
+ **/
+class LatencyHistogram
+{
+public:
+    void record(double ms)
+    {
+        uint64_t us = ms <= 0.0 ? 0 : static_cast<uint64_t>(ms * 1000.0 + 0.5);
+        auto& bucket = _counts[HistogramSnapshot::bucketOf(us)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        _sumUs.store(_sumUs.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+        if (us < _minUs.load(std::memory_order_relaxed)) _minUs.store(us, std::memory_order_relaxed);
+        if (us > _maxUs.load(std::memory_order_relaxed)) _maxUs.store(us, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const
+    {
+        HistogramSnapshot snap;
+        for (size_t i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+            snap.counts[i] = _counts[i].load(std::memory_order_relaxed);
+            snap.count += snap.counts[i];
+        }
+        snap.sumUs = _sumUs.load(std::memory_order_relaxed);
+        snap.minUs = snap.count ? _minUs.load(std::memory_order_relaxed) : 0;
+        snap.maxUs = _maxUs.load(std::memory_order_relaxed);
+        return snap;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::BUCKETS> _counts{};
+    std::atomic<uint64_t> _sumUs{0};
+    std::atomic<uint64_t> _minUs{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> _maxUs{0};
+};
@@ -0,0 +1,158 @@
+// Drives MotionTrigger::process() with synthetic scenes replayed through
+// RawFileSource, the raw YUYV source behind --replay: an object that
+// slides in and settles, one that keeps moving until max_settle_ms, and
+// one that passes straight through. Checks the state transitions, the
+// trigger and forced-trigger counts, the settle time and the per-frame
+// cost, and sumAbsDiff against a scalar loop. Built and run by make test.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "motion_trigger.hpp"
+#include "replay_camera.hpp"
+
+static const int WIDTH = 640, HEIGHT = 480;
+static const uint64_t FRAME_US = 33333;  // 30 fps
+
+// CPU time of process() allowed per frame; it is a few microseconds on the Pi
+static const double MAX_FRAME_COST_MS = 1.0;
+
+static const uint8_t BELT = 60, OBJECT = 200;
+static const int OBJECT_WIDTH = 240, OBJECT_HEIGHT = 200;
+
+using State = MotionTrigger::State;
+
+// Belt with a little sensor noise, plus the object at x (none if x < 0)
+static void draw(std::vector<uint8_t>& yuyv, int x, uint32_t& seed)
+{
+    for (int row = 0; row < HEIGHT; ++row) {
+        uint8_t* dst = yuyv.data() + static_cast<size_t>(row) * WIDTH * 2;
+        for (int col = 0; col < WIDTH; ++col) {
+            seed = seed * 1664525u + 1013904223u;
+            const bool inside = x >= 0 && col >= x && col < x + OBJECT_WIDTH && row >= 140 && row < 140 + OBJECT_HEIGHT;
+            dst[col * 2] = static_cast<uint8_t>((inside ? OBJECT : BELT) + (seed >> 30));
+            dst[col * 2 + 1] = 128;
+        }
+    }
+}
+
+struct Scene {
+    const char* name;
+    std::vector<int> object_x;     // per frame, -1 = empty belt
+    std::vector<State> states;     // expected, with repeats collapsed
+    uint64_t triggers, forced;
+    double min_settle_ms, max_settle_ms;
+};
+
+static bool run(const Scene& scene)
+{
+    // Recorded to a raw file and replayed the way --replay does, restamped at 30 fps
+    char path[] = "/tmp/motion_test_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return false;
+    }
+    FILE* file = fdopen(fd, "wb");
+    std::vector<uint8_t> yuyv(static_cast<size_t>(WIDTH) * HEIGHT * 2);
+    uint32_t seed = 1;
+    for (int x : scene.object_x) {
+        draw(yuyv, x, seed);
+        fwrite(yuyv.data(), 1, yuyv.size(), file);
+    }
+    fclose(file);
+
+    RawFileSource source(path, WIDTH, HEIGHT, 0.0);
+    source.streamOn();
+    MotionTrigger trigger;
+    std::vector<State> states{trigger.state()};
+    Frame frame;
+    frame.width = WIDTH;
+    frame.height = HEIGHT;
+    for (size_t i = 0; i < scene.object_x.size(); ++i) {
+        BufferSource::Buffer buf;
+        if (!source.dequeue(buf, 1000)) break;
+        frame.data.assign(buf.data, buf.data + buf.bytesused);
+        frame.sequence = static_cast<uint32_t>(i);
+        frame.timestamp_us = i * FRAME_US;
+        source.requeue(buf.index);
+
+        trigger.process(frame);
+        if (trigger.state() != states.back()) states.push_back(trigger.state());
+    }
+    source.streamOff();
+    unlink(path);
+
+    const HistogramSnapshot settle = trigger.settleTime();
+    const HistogramSnapshot cost = trigger.frameCost();
+    const double settle_ms = settle.count ? settle.maxUs / 1000.0 : 0.0;
+    const bool ok = trigger.frames() == scene.object_x.size() && states == scene.states &&
+                    trigger.triggers() == scene.triggers && trigger.forcedTriggers() == scene.forced &&
+                    settle_ms >= scene.min_settle_ms && settle_ms <= scene.max_settle_ms &&
+                    cost.percentileMs(0.99) <= MAX_FRAME_COST_MS;
+
+    std::cout << (ok ? "ok   " : "FAIL ") << scene.name << ": states";
+    for (State s : states) std::cout << " " << (s == State::Empty ? "Empty" : s == State::Arriving ? "Arriving" : "Present");
+    std::cout << ", " << trigger.triggers() << " triggers (" << trigger.forcedTriggers() << " forced), settle "
+              << settle_ms << " ms, process() mean " << cost.meanMs() * 1000.0 << " us, p99 "
+              << cost.percentileMs(0.99) * 1000.0 << " us\n";
+    return ok;
+}
+
+static bool sum_abs_diff()
+{
+    std::vector<uint8_t> a(4096 + 64), b(a.size());
+    uint32_t seed = 7;
+    for (size_t i = 0; i < a.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        a[i] = static_cast<uint8_t>(seed >> 24);
+        b[i] = static_cast<uint8_t>(seed >> 16);
+    }
+    // Every tail length, unaligned starts, full-scale differences and the 80 x 60 grid
+    std::vector<uint8_t> zeros(4800, 0), full(4800, 255);
+    size_t mismatches = 0, cases = 0;
+    auto check = [&](const uint8_t* x, const uint8_t* y, size_t n) {
+        uint64_t expected = 0;
+        for (size_t i = 0; i < n; ++i) expected += static_cast<uint64_t>(std::abs(x[i] - y[i]));
+        mismatches += MotionTrigger::sumAbsDiff(x, y, n) != expected;
+        ++cases;
+    };
+    for (size_t n = 0; n <= 67; ++n)
+        for (size_t offset = 0; offset < 3; ++offset) check(a.data() + offset, b.data() + 2 * offset, n);
+    check(a.data(), b.data(), 4096);
+    check(a.data() + 1, b.data(), 4095 + 64);
+    check(zeros.data(), full.data(), zeros.size());
+    check(full.data(), zeros.data(), zeros.size() - 1);
+
+    const bool ok = mismatches == 0;
+    std::cout << (ok ? "ok   " : "FAIL ") << "sumAbsDiff vs scalar: " << mismatches << " of " << cases
+              << " lengths differ\n";
+    return ok;
+}
+
+int main()
+{
+    // Default settings: settle after 3 still frames, forced after 300 ms
+    std::vector<int> settles(5, -1), forced(5, -1), passes(5, -1);
+    for (int x : {0, 48, 96, 144}) settles.push_back(x);
+    settles.insert(settles.end(), 10, 144);
+    settles.insert(settles.end(), 10, -1);
+    for (int i = 0; i < 16; ++i) forced.push_back(i % 2 ? 120 : 168);
+    forced.insert(forced.end(), 10, 168);
+    for (int x : {0, 120, 240, 360}) passes.push_back(x);
+    passes.insert(passes.end(), 10, -1);
+
+    bool ok = true;
+    // Arrives at frame 5, still from frame 9, captured with the third still frame (11)
+    ok &= run({"slides in and settles", settles, {State::Empty, State::Arriving, State::Present, State::Empty},
+               1, 0, 6 * FRAME_US / 1000.0 * 0.97, 6 * FRAME_US / 1000.0 * 1.03});
+    // Never still: captured on the first frame 300 ms after arrival
+    ok &= run({"keeps moving          ", forced, {State::Empty, State::Arriving, State::Present},
+               1, 1, 300.0, 300.0 + FRAME_US / 1000.0});
+    ok &= run({"passes straight by    ", passes, {State::Empty, State::Arriving, State::Empty}, 0, 0, 0.0, 0.0});
+    ok &= sum_abs_diff();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+#include "motion_trigger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <pthread.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Coarse grid over the zone, about this many samples across and down
+static const int GRID_COLUMNS = 80;
+static const int GRID_ROWS = 60;
+
+uint64_t MotionTrigger::sumAbsDiff(const uint8_t* a, const uint8_t* b, size_t n)
+{
+    uint64_t sum = 0;
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= n; i += 16) acc = vpadalq_u16(acc, vpaddlq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i))));
+    sum = vaddvq_u32(acc);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+    }
+    sum = static_cast<uint64_t>(_mm_cvtsi128_si32(acc)) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+    for (; i < n; ++i) sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    return sum;
+}
+
+MotionTrigger::MotionTrigger(MotionSettings settings) : settings(settings)
+{
+}
+
+MotionTrigger::~MotionTrigger()
+{
+    stop();
+}
+
+void MotionTrigger::start(StreamingRing& ring, int affinity, int priority)
+{
+    if (running) return;
+    running = true;
+    thr = std::thread(&MotionTrigger::worker, this, &ring, affinity, priority);
+}
+
+void MotionTrigger::stop()
+{
+    if (!running) return;
+    running = false;
+    thr.join();
+}
+
+void MotionTrigger::worker(StreamingRing* ring, int affinity, int priority)
+{
+    if (affinity >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(affinity, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+            perror("Failed to set motion trigger thread affinity");
+    }
+    if (priority > 0) {
+        sched_param sch_params;
+        sch_params.sched_priority = priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch_params) != 0)
+            perror("Failed to set motion trigger thread priority");
+    }
+
+    uint64_t last_us = 0;
+    while (running) {
+        FramePtr frame = ring->waitNewer(last_us, std::chrono::milliseconds(500));
+        if (!frame) continue;
+        last_us = frame->timestamp_us;
+        if (process(*frame) && trigger_callback) trigger_callback(frame);
+    }
+}
+
+void MotionTrigger::configure(const Frame& frame)
+{
+    if (frame.width == frame_width && frame.height == frame_height) return;
+    frame_width = frame.width;
+    frame_height = frame.height;
+
+    zone = settings.zone;
+    if (zone.empty()) zone = frame.bounds();
+    zone.x = std::clamp(zone.x, 0, frame.width - 1);
+    zone.y = std::clamp(zone.y, 0, frame.height - 1);
+    zone.width = std::min(zone.width, frame.width - zone.x);
+    zone.height = std::min(zone.height, frame.height - zone.y);
+
+    step_x = std::max(1, zone.width / GRID_COLUMNS);
+    step_y = std::max(1, zone.height / GRID_ROWS);
+    grid_width = zone.width / step_x;
+    grid_height = zone.height / step_y;
+
+    const size_t cells = static_cast<size_t>(grid_width) * grid_height;
+    current.assign(cells, 0);
+    previous.clear();
+    empty.assign(cells, 0);
+    empty8.assign(cells, 0);
+    current_state = State::Empty;
+    still_count = 0;
+}
+
+void MotionTrigger::sample(const Frame& frame)
+{
+    const uint8_t* base = frame.yuyv(zone);
+    for (int r = 0; r < grid_height; ++r) {
+        const uint8_t* row = base + static_cast<size_t>(r) * step_y * frame.stride();
+        uint8_t* dst = current.data() + static_cast<size_t>(r) * grid_width;
+        for (int c = 0; c < grid_width; ++c) dst[c] = row[static_cast<size_t>(c) * step_x * 2];
+    }
+}
+
+// empty += (current - empty) / 2^shift, in 8.8 fixed point
+void MotionTrigger::learn_empty()
+{
+    const int shift = std::clamp(settings.learn_shift, 0, 8);
+    for (size_t i = 0; i < current.size(); ++i) {
+        empty[i] = static_cast<uint16_t>(empty[i] - (empty[i] >> shift) + (current[i] << (8 - shift)));
+        empty8[i] = static_cast<uint8_t>((empty[i] + 128) >> 8);
+    }
+}
+
+bool MotionTrigger::process(const Frame& frame)
+{
+    auto start = std::chrono::steady_clock::now();
+    configure(frame);
+    sample(frame);
+    frame_count.fetch_add(1, std::memory_order_relaxed);
+
+    // The first frame is taken as the empty belt
+    if (previous.empty()) {
+        previous = current;
+        empty8 = current;
+        for (size_t i = 0; i < current.size(); ++i) empty[i] = static_cast<uint16_t>(current[i] << 8);
+        return false;
+    }
+
+    const float cells = static_cast<float>(current.size());
+    const bool moving = sumAbsDiff(current.data(), previous.data(), current.size()) / cells >= settings.motion_level;
+    const bool there = sumAbsDiff(current.data(), empty8.data(), current.size()) / cells >= settings.presence_level;
+    previous = current;
+
+    const int still = moving ? 0 : still_count.load(std::memory_order_relaxed) + 1;
+    still_count.store(still, std::memory_order_relaxed);
+
+    bool fire = false;
+    switch (state()) {
+    case State::Empty:
+        if (moving && there) {
+            arrived_us = frame.timestamp_us;
+            current_state.store(State::Arriving, std::memory_order_release);
+        } else if (!moving) {
+            learn_empty();
+        }
+        break;
+    case State::Arriving: {
+        const bool timed_out = frame.timestamp_us - arrived_us >= settings.max_settle_ms * 1000.0;
+        if (!there && still >= settings.settle_frames) {
+            // Passed straight through, or it was only a shadow
+            current_state.store(State::Empty, std::memory_order_release);
+        } else if (there && (still >= settings.settle_frames || timed_out)) {
+            fire = true;
+            if (still < settings.settle_frames) forced_count.fetch_add(1, std::memory_order_relaxed);
+            trigger_count.fetch_add(1, std::memory_order_relaxed);
+            settle_time.record((frame.timestamp_us - arrived_us) / 1000.0);
+            absent_count = 0;
+            current_state.store(State::Present, std::memory_order_release);
+        }
+        break;
+    }
+    case State::Present:
+        absent_count = there ? 0 : absent_count + 1;
+        if (absent_count >= settings.settle_frames) current_state.store(State::Empty, std::memory_order_release);
+        break;
+    }
+
+    frame_cost.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return fire;
+}
@@ -0,0 +1,125 @@
+// motion_trigger.hpp
+#ifndef MOTION_TRIGGER_HPP
+#define MOTION_TRIGGER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "frame.hpp"
+#include "latency_histogram.hpp"
+#include "streaming_ring.hpp"
+
+struct MotionSettings {
+    // Watched region in pixels, the whole frame if empty
+    Roi zone;
+
+    // Mean |luma - previous frame| over the zone that counts as movement
+    float motion_level = 4.0f;
+
+    // Mean |luma - empty belt| over the zone that counts as an object being there
+    float presence_level = 8.0f;
+
+    // Still frames in a row before the object counts as settled (or gone)
+    int settle_frames = 3;
+
+    // Capture anyway if the object is still moving this long after it arrived
+    double max_settle_ms = 300.0;
+
+    // Empty belt reference follows slow lighting changes at 1 / 2^learn_shift per still frame
+    int learn_shift = 4;
+};
+
+/**
+ * Object arrival trigger driven by the camera stream instead of the
+ * ultrasonic sensor. Every streamed frame is sampled onto a coarse
+ * luma grid over the watched zone (about 80 x 60) and differenced
+ * against the previous frame (motion) and against the empty belt
+ * (presence):
+ *
+ *   Empty     --motion + presence-->       Arriving
+ *   Arriving  --still settle_frames-->     capture, Present
+ *             (or max_settle_ms since arrival, still moving)
+ *   Arriving  --still, nothing there-->    Empty
+ *   Present   --nothing there settle_frames--> Empty
+ *
+ * The trigger fires once per object, with the first settled frame. It
+ * runs on its own thread, waiting on the streaming ring, and costs a
+ * few microseconds per frame, so it keeps up with the full frame rate
+ * on the camera's core.
+ **/
+class MotionTrigger {
+public:
+    enum class State { Empty, Arriving, Present };
+
+    // Runs on the trigger thread; must only hand the frame over
+    using TriggerCallback = std::function<void(const FramePtr& frame)>;
+
+    explicit MotionTrigger(MotionSettings settings = MotionSettings());
+    ~MotionTrigger();
+
+    MotionTrigger(const MotionTrigger&) = delete;
+    MotionTrigger& operator=(const MotionTrigger&) = delete;
+
+    void onTrigger(TriggerCallback callback) { trigger_callback = std::move(callback); }
+
+    void start(StreamingRing& ring, int affinity = -1, int priority = 0);
+    void stop();
+
+    // One frame through the state machine; true if it is the one to capture.
+    // Called by the thread, or directly when driving the trigger by hand.
+    bool process(const Frame& frame);
+
+    State state() const { return current_state.load(std::memory_order_acquire); }
+
+    // Nothing in the zone and nothing moving
+    bool idle() const { return state() == State::Empty && still_count.load(std::memory_order_relaxed) > 0; }
+
+    uint64_t frames() const { return frame_count.load(std::memory_order_relaxed); }
+    uint64_t triggers() const { return trigger_count.load(std::memory_order_relaxed); }
+
+    // Triggers that hit max_settle_ms with the object still moving
+    uint64_t forcedTriggers() const { return forced_count.load(std::memory_order_relaxed); }
+
+    // Arrival to capture, by frame timestamps
+    HistogramSnapshot settleTime() const { return settle_time.snapshot(); }
+
+    // CPU time of process() per frame
+    HistogramSnapshot frameCost() const { return frame_cost.snapshot(); }
+
+    // Sum of |a[i] - b[i]| over n bytes, NEON or SSE2 with a scalar tail
+    static uint64_t sumAbsDiff(const uint8_t* a, const uint8_t* b, size_t n);
+
+private:
+    const MotionSettings settings;
+    Roi zone;
+    int step_x = 2, step_y = 1, grid_width = 0, grid_height = 0;
+    int frame_width = 0, frame_height = 0;
+
+    std::vector<uint8_t> current, previous;
+    std::vector<uint16_t> empty;     // empty belt, 8.8 fixed point
+    std::vector<uint8_t> empty8;
+
+    std::atomic<State> current_state{State::Empty};
+    std::atomic<int> still_count{0};
+    int absent_count = 0;
+    uint64_t arrived_us = 0;
+
+    std::thread thr;
+    std::atomic<bool> running{false};
+    TriggerCallback trigger_callback;
+
+    std::atomic<uint64_t> frame_count{0};
+    std::atomic<uint64_t> trigger_count{0};
+    std::atomic<uint64_t> forced_count{0};
+    LatencyHistogram settle_time;
+    LatencyHistogram frame_cost;
+
+    void configure(const Frame& frame);
+    void sample(const Frame& frame);
+    void learn_empty();
+    void worker(StreamingRing* ring, int affinity, int priority);
+};
+
+#endif // MOTION_TRIGGER_HPP
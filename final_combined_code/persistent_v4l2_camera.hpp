@@ -11,58 +11,165 @@
 #include <string>
 #include <stdexcept>
 #include <cstring>
+#include <algorithm>
 #include <iostream>
-
-class PersistentV4L2Camera {
+#include <memory>
+#include <vector>
+#include "frame.hpp"
+#include "camera.hpp"
+#include "streaming_ring.hpp"
+
+/**
+ * V4L2 webcam kept open for the lifetime of the program.
+ *
+ * With a single buffer every capture() queues it and waits for the
+ * next exposure. With num_buffers > 1, startStreaming() keeps all
+ * buffers cycling on a StreamingRing thread and capture()/latest()
+ * return the newest frame immediately.
+ **/
+class PersistentV4L2Camera : public Camera, public BufferSource {
 public:
-    PersistentV4L2Camera(const std::string& device = "/dev/video0", int width = 640, int height = 480)
-        : fd(-1), buffer(nullptr), buffer_length(0), WIDTH(width), HEIGHT(height)
+    PersistentV4L2Camera(const std::string& device = "/dev/video0", int width = 640, int height = 480,
+                         int num_buffers = 1)
+        : fd(-1), WIDTH(width), HEIGHT(height),
+          pool(FRAME_POOL_SIZE, static_cast<size_t>(width) * height * 2)
     {
-        open_device(device);
+        open_device(device, num_buffers);
     }
 
-    ~PersistentV4L2Camera() {
+    ~PersistentV4L2Camera() override {
+        ring.reset();
         if (fd >= 0) {
             v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
             ioctl(fd, VIDIOC_STREAMOFF, &type);
-            if (buffer) munmap(buffer, buffer_length);
+            for (auto& b : buffers) munmap(b.start, b.length);
             close(fd);
         }
     }
 
-    bool captureToFile(const std::string& filename) {
+    // Starts continuous capture on a dedicated thread (needs num_buffers > 1)
+    bool startStreaming(int affinity = -1, int priority = 0) override {
+        if (buffers.size() < 2) {
+            std::cerr << "Streaming needs more than one buffer\n";
+            return false;
+        }
+        if (!ring) ring = std::make_unique<StreamingRing>(*this);
+        return ring->start(affinity, priority);
+    }
+
+    StreamingRing* streamingRing() override { return ring.get(); }
+
+    // Streaming: the newest frame. Otherwise dequeues one frame on demand.
+    // Either way the frame is a pooled copy, nullptr on failure.
+    FramePtr capture() override {
+        if (ring) {
+            FramePtr frame = ring->latest();
+            return frame ? frame : ring->waitNewer(0, std::chrono::seconds(2));
+        }
+
         v4l2_buffer buf{};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         buf.memory = V4L2_MEMORY_MMAP;
         buf.index = 0;
 
-        if (ioctl(fd, VIDIOC_QBUF, &buf) < 0) return false;
+        if (ioctl(fd, VIDIOC_QBUF, &buf) < 0) return nullptr;
 
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(fd, &fds);
-        timeval tv = {2, 0};
-
-        if (select(fd + 1, &fds, NULL, NULL, &tv) <= 0) {
+        if (!wait_readable(2000)) {
             std::cerr << "Timeout waiting for frame\n";
-            return false;
+            return nullptr;
         }
 
+        if (ioctl(fd, VIDIOC_DQBUF, &buf) < 0) return nullptr;
+
+        std::shared_ptr<Frame> frame = pool.acquire();
+        if (!frame) {
+            std::cerr << "Frame pool exhausted\n";
+            return nullptr;
+        }
+        frame->width = WIDTH;
+        frame->height = HEIGHT;
+        frame->sequence = buf.sequence;
+        frame->timestamp_us = buf.timestamp.tv_sec * 1000000ULL + buf.timestamp.tv_usec;
+        frame->bytesused = std::min<size_t>(buf.bytesused, frame->data.size());
+        std::memcpy(frame->data.data(), buffers[0].start, frame->bytesused);
+        return frame;
+    }
+
+    bool captureToFile(const std::string& filename) {
+        FramePtr frame = capture();
+        return frame && saveFrame(*frame, filename);
+    }
+
+    // BufferSource, driven by the StreamingRing thread
+    bool streamOn() override {
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            if (!queue_buffer(i)) return false;
+        }
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        return ioctl(fd, VIDIOC_STREAMON, &type) == 0;
+    }
+
+    void streamOff() override {
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        ioctl(fd, VIDIOC_STREAMOFF, &type);
+    }
+
+    bool dequeue(Buffer& out, int timeout_ms) override {
+        if (!wait_readable(timeout_ms)) return false;
+
+        v4l2_buffer buf{};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
         if (ioctl(fd, VIDIOC_DQBUF, &buf) < 0) return false;
 
-        cv::Mat yuyv(HEIGHT, WIDTH, CV_8UC2, buffer);
-        cv::Mat bgr;
-        cv::cvtColor(yuyv, bgr, cv::COLOR_YUV2BGR_YUYV);
-        return cv::imwrite(filename, bgr);
+        out.index = buf.index;
+        out.data = static_cast<const uint8_t*>(buffers[buf.index].start);
+        out.bytesused = buf.bytesused;
+        out.sequence = buf.sequence;
+        out.timestamp_us = buf.timestamp.tv_sec * 1000000ULL + buf.timestamp.tv_usec;
+        return true;
     }
 
+    void requeue(int index) override {
+        if (!queue_buffer(index)) perror("VIDIOC_QBUF");
+    }
+
+    int width() const override { return WIDTH; }
+    int height() const override { return HEIGHT; }
+
 private:
+    struct MappedBuffer {
+        void* start;
+        size_t length;
+    };
+
     int fd;
-    void* buffer;
-    size_t buffer_length;
+    std::vector<MappedBuffer> buffers;
     const int WIDTH, HEIGHT;
 
-    void open_device(const std::string& device) {
+    // Enough for one frame in capture, one queued and one being classified
+    static constexpr size_t FRAME_POOL_SIZE = 4;
+    FramePool pool;
+
+    std::unique_ptr<StreamingRing> ring;
+
+    bool queue_buffer(size_t index) {
+        v4l2_buffer buf{};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = index;
+        return ioctl(fd, VIDIOC_QBUF, &buf) == 0;
+    }
+
+    bool wait_readable(int timeout_ms) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        return select(fd + 1, &fds, NULL, NULL, &tv) > 0;
+    }
+
+    void open_device(const std::string& device, int num_buffers) {
         fd = open(device.c_str(), O_RDWR);
         if (fd < 0) throw std::runtime_error("Failed to open device");
 
@@ -77,29 +184,35 @@ private:
             throw std::runtime_error("VIDIOC_S_FMT failed");
 
         v4l2_requestbuffers req{};
-        req.count = 1;
+        req.count = num_buffers;
         req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         req.memory = V4L2_MEMORY_MMAP;
 
-        if (ioctl(fd, VIDIOC_REQBUFS, &req) < 0)
+        if (ioctl(fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 1)
             throw std::runtime_error("VIDIOC_REQBUFS failed");
 
-        v4l2_buffer buf{};
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = 0;
+        // The driver may grant a different number of buffers than requested
+        for (unsigned i = 0; i < req.count; ++i) {
+            v4l2_buffer buf{};
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            buf.index = i;
 
-        if (ioctl(fd, VIDIOC_QUERYBUF, &buf) < 0)
-            throw std::runtime_error("VIDIOC_QUERYBUF failed");
+            if (ioctl(fd, VIDIOC_QUERYBUF, &buf) < 0)
+                throw std::runtime_error("VIDIOC_QUERYBUF failed");
 
-        buffer_length = buf.length;
-        buffer = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
-        if (buffer == MAP_FAILED)
-            throw std::runtime_error("mmap failed");
+            void* start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+            if (start == MAP_FAILED)
+                throw std::runtime_error("mmap failed");
+            buffers.push_back({start, buf.length});
+        }
 
-        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        if (ioctl(fd, VIDIOC_STREAMON, &type) < 0)
-            throw std::runtime_error("VIDIOC_STREAMON failed");
+        // Single-buffer mode streams from the start and queues per capture()
+        if (buffers.size() == 1) {
+            v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            if (ioctl(fd, VIDIOC_STREAMON, &type) < 0)
+                throw std::runtime_error("VIDIOC_STREAMON failed");
+        }
     }
 };
 
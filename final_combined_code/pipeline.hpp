@@ -0,0 +1,85 @@
+// pipeline.hpp
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "classification.hpp"
+#include "frame.hpp"
+#include "spsc_queue.hpp"
+
+/**
+ * One item travelling through trigger/capture -> preprocess -> infer ->
+ * actuate. Stages pass it along through bounded SpscQueues; the item
+ * carries everything a later stage needs, so several items can be in
+ * flight at once.
+ **/
+struct PipelineItem {
+    uint64_t id = 0;
+    uint64_t trigger_us = 0;     // CLOCK_MONOTONIC
+    float distance_cm = 0.0f;
+    FramePtr frame;
+    Roi roi;                     // part of the frame the model sees, the whole frame without --roi
+    uint64_t frame_us = 0;       // timestamp of the newest frame classified so far
+    uint64_t frame_hash = 0;     // ResultCache::hash of the roi, if the cache is on
+    uint64_t generation = 0;     // ResultCache::generation() when it was captured
+    int64_t log_record = -1;     // offset of the item's capture log record, -1 if not logged
+    std::vector<uint8_t> tensor; // model input in the model's type, filled by the preprocess stage
+    ClassificationResult result;
+};
+
+using ItemPtr = std::shared_ptr<PipelineItem>;
+
+template<size_t Capacity>
+using ItemQueue = SpscQueue<ItemPtr, Capacity>;
+
+/**
+ * Fixed set of preallocated items. The pool size is the pipeline
+ * depth: the trigger stage can't start an item while every item is
+ * still on its way through the later stages. Released items drop
+ * their frame so it goes back to the camera's pool straight away.
+ **/
+class PipelineItemPool {
+public:
+    PipelineItemPool(size_t count, size_t tensor_bytes) : state(std::make_shared<State>()) {
+        for (size_t i = 0; i < count; ++i) {
+            auto item = std::make_unique<PipelineItem>();
+            item->tensor.resize(tensor_bytes);
+            state->free.push_back(std::move(item));
+        }
+        state->total = count;
+    }
+
+    // Returns nullptr if every item is in flight
+    ItemPtr acquire() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->free.empty()) return nullptr;
+        PipelineItem* item = state->free.back().release();
+        state->free.pop_back();
+        std::shared_ptr<State> owner = state;
+        return ItemPtr(item, [owner](PipelineItem* i) {
+            i->frame.reset();
+            i->log_record = -1;
+            i->result = {};
+            std::lock_guard<std::mutex> lock(owner->mutex);
+            owner->free.emplace_back(i);
+        });
+    }
+
+    size_t inFlight() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->total - state->free.size();
+    }
+
+private:
+    struct State {
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<PipelineItem>> free;
+        size_t total = 0;
+    };
+    std::shared_ptr<State> state;
+};
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,84 @@
+// Checks ColorPrefilter::features(), whose texture sums are SSE2 or NEON,
+// against a scalar pass over the same rows: random frames and crops of
+// them, at widths that leave the vector loops a scalar tail (odd pixel
+// pair counts included). Built and run by make test.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "color_prefilter.hpp"
+
+using Features = ColorPrefilter::Features;
+
+// Histograms and texture sums one pixel pair at a time, in the order of
+// the header's feature list
+static Features scalar_features(const uint8_t* yuyv, int width, int height, size_t stride)
+{
+    uint32_t chroma[ColorPrefilter::CHROMA_BINS] = {}, luma[ColorPrefilter::LUMA_BINS] = {};
+    uint64_t hsum = 0, vsum = 0, pairs = 0;
+    for (int y = 0; y + 1 < height; y += ColorPrefilter::ROW_STEP) {
+        const uint8_t* row = yuyv + static_cast<size_t>(y) * stride;
+        const uint8_t* below = row + stride;
+        for (int p = 0; p < width / 2; ++p, ++pairs) {
+            const uint8_t* a = row + p * 4;
+            const uint8_t* b = below + p * 4;
+            chroma[(a[1] >> 5) * 8 + (a[3] >> 5)]++;
+            luma[a[0] >> 5]++;
+            luma[a[2] >> 5]++;
+            hsum += std::abs(a[0] - a[2]);
+            vsum += std::abs(a[0] - b[0]) + std::abs(a[2] - b[2]);
+        }
+    }
+
+    Features out{};
+    const float per_pair = pairs ? 1.0f / pairs : 0.0f;
+    for (int i = 0; i < ColorPrefilter::CHROMA_BINS; ++i) out[i] = chroma[i] * per_pair;
+    for (int i = 0; i < ColorPrefilter::LUMA_BINS; ++i) out[ColorPrefilter::CHROMA_BINS + i] = luma[i] * per_pair * 0.5f;
+    out[ColorPrefilter::CHROMA_BINS + ColorPrefilter::LUMA_BINS] = hsum * per_pair / 255.0f;
+    out[ColorPrefilter::CHROMA_BINS + ColorPrefilter::LUMA_BINS + 1] = vsum * per_pair * 0.5f / 255.0f;
+    return out;
+}
+
+int main()
+{
+    const int frame_width = 662, frame_height = 497;
+    const size_t stride = static_cast<size_t>(frame_width) * 2;
+    std::vector<uint8_t> frame(stride * frame_height);
+    uint32_t seed = 1;
+    for (uint8_t& v : frame) {
+        seed = seed * 1664525u + 1013904223u;
+        v = static_cast<uint8_t>(seed >> 24);
+    }
+
+    // Whole frames of each size, then crops at odd pair offsets with the frame's stride
+    struct Case { int x, y, width, height; };
+    std::vector<Case> cases;
+    for (int width : {640, 662, 638, 322, 130, 70, 36, 18, 2})
+        for (int height : {480, 497, 63, 6, 2})
+            cases.push_back({0, 0, width, height});
+    for (int x : {2, 6, 30})
+        for (int width : {190, 222, 98})
+            cases.push_back({x, x * 3 + 1, width, width + 7});
+
+    int mismatches = 0;
+    for (const Case& c : cases) {
+        const uint8_t* crop = frame.data() + c.y * stride + c.x * 2;
+        Features got;
+        ColorPrefilter::features(crop, c.width, c.height, stride, got);
+        const Features expected = scalar_features(crop, c.width, c.height, stride);
+        float max_diff = 0.0f;
+        for (int i = 0; i < ColorPrefilter::FEATURES; ++i) max_diff = std::max(max_diff, std::abs(got[i] - expected[i]));
+        if (max_diff > 1e-6f) {
+            std::cout << "FAIL " << c.width << "x" << c.height << "+" << c.x << "+" << c.y << ": features differ by up to "
+                      << max_diff << "\n";
+            mismatches++;
+        }
+    }
+
+    const bool ok = mismatches == 0;
+    std::cout << (ok ? "ok   " : "FAIL ") << "features vs scalar: " << mismatches << " of " << cases.size()
+              << " frames and crops differ\n";
+    return ok ? 0 : 1;
+}
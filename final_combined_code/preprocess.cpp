@@ -0,0 +1,252 @@
+#include "preprocess.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+// ITU-R BT.601 video range, same constants as cv::COLOR_YUV2RGB_YUYV
+static const float CY = 1.164f;
+static const float CVR = 1.596f;
+static const float CUG = -0.391f;
+static const float CVG = -0.813f;
+static const float CUB = 2.018f;
+
+// MobileNetV2 preprocess_input: x / 127.5 - 1
+static const float NORM_SCALE = 1.0f / 127.5f;
+
+YuyvPreprocessor::YuyvPreprocessor(int dst_width, int dst_height)
+    : dst_width(dst_width), dst_height(dst_height),
+      ybuf(dst_width), ubuf(dst_width), vbuf(dst_width), qrow(static_cast<size_t>(dst_width) * 3)
+{
+}
+
+void YuyvPreprocessor::build_taps(Taps& taps, int src, int dst)
+{
+    taps.start.assign(dst, 0);
+    taps.count.assign(dst, 0);
+    taps.offset.assign(dst, 0);
+    taps.weight.clear();
+
+    const double scale = static_cast<double>(src) / dst;
+    for (int i = 0; i < dst; ++i) {
+        double lo = i * scale;
+        double hi = std::min<double>((i + 1) * scale, src);
+        int first = static_cast<int>(lo);
+        int last = std::min(static_cast<int>(std::ceil(hi)), src);
+
+        taps.start[i] = first;
+        taps.count[i] = last - first;
+        taps.offset[i] = static_cast<int>(taps.weight.size());
+        for (int s = first; s < last; ++s) {
+            double overlap = std::min<double>(s + 1, hi) - std::max<double>(s, lo);
+            taps.weight.push_back(static_cast<float>(overlap / scale));
+        }
+    }
+}
+
+void YuyvPreprocessor::configure(int width, int height)
+{
+    if (width == src_width && height == src_height) return;
+    src_width = width;
+    src_height = height;
+    build_taps(xtaps, width, dst_width);
+    build_taps(ytaps, height, dst_height);
+    vrow.assign(static_cast<size_t>(width) * 2, 0.0f);
+}
+
+void YuyvPreprocessor::toFloatTensor(const uint8_t* yuyv, int width, int height, size_t stride, float* dst)
+{
+    configure(width, height);
+    for (int dy = 0; dy < dst_height; ++dy) {
+        blend_rows(yuyv, stride, dy);
+        resample_row();
+        convert_row(dst + static_cast<size_t>(dy) * dst_width * 3, NORM_SCALE, -1.0f);
+    }
+}
+
+void YuyvPreprocessor::toUint8Tensor(const uint8_t* yuyv, int width, int height, size_t stride,
+                                     uint8_t* dst, float scale, int zero_point)
+{
+    to_quantized(yuyv, width, height, stride, dst, scale, zero_point, 0, 255);
+}
+
+void YuyvPreprocessor::toInt8Tensor(const uint8_t* yuyv, int width, int height, size_t stride,
+                                    int8_t* dst, float scale, int zero_point)
+{
+    to_quantized(yuyv, width, height, stride, dst, scale, zero_point, -128, 127);
+}
+
+// q = (rgb / 127.5 - 1) / scale + zero_point, as one gain and bias on the
+// clamped RGB value, then rounded half up and saturated to [lo, hi]
+template<typename T>
+void YuyvPreprocessor::to_quantized(const uint8_t* yuyv, int width, int height, size_t stride,
+                                    T* dst, float scale, int zero_point, int lo, int hi)
+{
+    const float gain = NORM_SCALE / scale;
+    const float bias = zero_point - 1.0f / scale;
+    const float flo = static_cast<float>(lo), fhi = static_cast<float>(hi);
+    const size_t row_size = static_cast<size_t>(dst_width) * 3;
+
+    configure(width, height);
+    for (int dy = 0; dy < dst_height; ++dy) {
+        blend_rows(yuyv, stride, dy);
+        resample_row();
+        convert_row(qrow.data(), gain, bias);
+
+        // Shifted to be non-negative so truncation rounds. The byte stores
+        // could alias the floats as far as the compiler knows, hence __restrict.
+        const float* __restrict src = qrow.data();
+        T* __restrict out = dst + static_cast<size_t>(dy) * row_size;
+        for (size_t k = 0; k < row_size; ++k) {
+            const float q = std::min(std::max(src[k], flo), fhi) - flo + 0.5f;
+            out[k] = static_cast<T>(static_cast<int>(q) + lo);
+        }
+    }
+}
+
+// vrow = sum(w * source row) over the rows covered by output row dy.
+// Works on the raw interleaved bytes, so Y, U and V are blended together.
+void YuyvPreprocessor::blend_rows(const uint8_t* yuyv, size_t stride, int dy)
+{
+    const int n = src_width * 2;
+    float* acc = vrow.data();
+    std::fill(vrow.begin(), vrow.end(), 0.0f);
+
+    for (int t = 0; t < ytaps.count[dy]; ++t) {
+        const uint8_t* row = yuyv + static_cast<size_t>(ytaps.start[dy] + t) * stride;
+        const float w = ytaps.weight[ytaps.offset[dy] + t];
+        int i = 0;
+#if defined(__ARM_NEON)
+        const float32x4_t vw = vdupq_n_f32(w);
+        for (; i + 16 <= n; i += 16) {
+            uint8x16_t b = vld1q_u8(row + i);
+            uint16x8_t lo = vmovl_u8(vget_low_u8(b));
+            uint16x8_t hi = vmovl_u8(vget_high_u8(b));
+            float32x4_t f0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo)));
+            float32x4_t f1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo)));
+            float32x4_t f2 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi)));
+            float32x4_t f3 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi)));
+            vst1q_f32(acc + i,      vmlaq_f32(vld1q_f32(acc + i),      f0, vw));
+            vst1q_f32(acc + i + 4,  vmlaq_f32(vld1q_f32(acc + i + 4),  f1, vw));
+            vst1q_f32(acc + i + 8,  vmlaq_f32(vld1q_f32(acc + i + 8),  f2, vw));
+            vst1q_f32(acc + i + 12, vmlaq_f32(vld1q_f32(acc + i + 12), f3, vw));
+        }
+#elif defined(__SSE2__)
+        const __m128 vw = _mm_set1_ps(w);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= n; i += 16) {
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            __m128i lo = _mm_unpacklo_epi8(b, zero);
+            __m128i hi = _mm_unpackhi_epi8(b, zero);
+            __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+            __m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+            __m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+            __m128 f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+            _mm_storeu_ps(acc + i,      _mm_add_ps(_mm_loadu_ps(acc + i),      _mm_mul_ps(f0, vw)));
+            _mm_storeu_ps(acc + i + 4,  _mm_add_ps(_mm_loadu_ps(acc + i + 4),  _mm_mul_ps(f1, vw)));
+            _mm_storeu_ps(acc + i + 8,  _mm_add_ps(_mm_loadu_ps(acc + i + 8),  _mm_mul_ps(f2, vw)));
+            _mm_storeu_ps(acc + i + 12, _mm_add_ps(_mm_loadu_ps(acc + i + 12), _mm_mul_ps(f3, vw)));
+        }
+#endif
+        for (; i < n; ++i) {
+            acc[i] += w * row[i];
+        }
+    }
+}
+
+// Horizontal area taps from the blended YUYV row into planar Y, U, V.
+// Pixel x has luma at 2x and shares the chroma of its pair (4*(x/2)+1, +3).
+void YuyvPreprocessor::resample_row()
+{
+    const float* row = vrow.data();
+    for (int dx = 0; dx < dst_width; ++dx) {
+        const float* w = xtaps.weight.data() + xtaps.offset[dx];
+        float y = 0.0f, u = 0.0f, v = 0.0f;
+        for (int t = 0; t < xtaps.count[dx]; ++t) {
+            const int x = xtaps.start[dx] + t;
+            const int pair = (x >> 1) << 2;
+            y += w[t] * row[2 * x];
+            u += w[t] * row[pair + 1];
+            v += w[t] * row[pair + 3];
+        }
+        ybuf[dx] = y;
+        ubuf[dx] = u;
+        vbuf[dx] = v;
+    }
+}
+
+static inline void convert_pixel(float y, float u, float v, float* dst, float gain, float bias)
+{
+    const float c = CY * (y - 16.0f);
+    const float d = u - 128.0f;
+    const float e = v - 128.0f;
+    const float r = std::clamp(c + CVR * e, 0.0f, 255.0f);
+    const float g = std::clamp(c + CUG * d + CVG * e, 0.0f, 255.0f);
+    const float b = std::clamp(c + CUB * d, 0.0f, 255.0f);
+    dst[0] = r * gain + bias;
+    dst[1] = g * gain + bias;
+    dst[2] = b * gain + bias;
+}
+
+#if defined(__SSE2__) && !defined(__ARM_NEON)
+// Writes 4 RGB pixels as 4 overlapping 16-byte stores (r g b x); each x is
+// overwritten by the next pixel, so the caller must leave at least one
+// more float in the row.
+static inline void store_rgb4(float* dst, __m128 r, __m128 g, __m128 b)
+{
+    __m128 a = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(r, g, b, a);
+    _mm_storeu_ps(dst, r);
+    _mm_storeu_ps(dst + 3, g);
+    _mm_storeu_ps(dst + 6, b);
+    _mm_storeu_ps(dst + 9, a);
+}
+#endif
+
+// dst = clamped RGB * gain + bias; NORM_SCALE and -1 give the float tensor
+void YuyvPreprocessor::convert_row(float* dst, float gain, float bias)
+{
+    int i = 0;
+#if defined(__ARM_NEON)
+    const float32x4_t v16 = vdupq_n_f32(16.0f), v128 = vdupq_n_f32(128.0f);
+    const float32x4_t vmin = vdupq_n_f32(0.0f), vmax = vdupq_n_f32(255.0f);
+    const float32x4_t vgain = vdupq_n_f32(gain), vbias = vdupq_n_f32(bias);
+    for (; i + 4 <= dst_width; i += 4) {
+        float32x4_t c = vmulq_n_f32(vsubq_f32(vld1q_f32(&ybuf[i]), v16), CY);
+        float32x4_t d = vsubq_f32(vld1q_f32(&ubuf[i]), v128);
+        float32x4_t e = vsubq_f32(vld1q_f32(&vbuf[i]), v128);
+        float32x4_t r = vmlaq_n_f32(c, e, CVR);
+        float32x4_t g = vmlaq_n_f32(vmlaq_n_f32(c, d, CUG), e, CVG);
+        float32x4_t b = vmlaq_n_f32(c, d, CUB);
+        float32x4x3_t rgb;
+        rgb.val[0] = vmlaq_f32(vbias, vminq_f32(vmaxq_f32(r, vmin), vmax), vgain);
+        rgb.val[1] = vmlaq_f32(vbias, vminq_f32(vmaxq_f32(g, vmin), vmax), vgain);
+        rgb.val[2] = vmlaq_f32(vbias, vminq_f32(vmaxq_f32(b, vmin), vmax), vgain);
+        vst3q_f32(dst + 3 * i, rgb);
+    }
+#elif defined(__SSE2__)
+    const __m128 v16 = _mm_set1_ps(16.0f), v128 = _mm_set1_ps(128.0f);
+    const __m128 vmin = _mm_setzero_ps(), vmax = _mm_set1_ps(255.0f);
+    const __m128 vgain = _mm_set1_ps(gain), vbias = _mm_set1_ps(bias);
+    for (; i + 4 < dst_width; i += 4) {
+        __m128 c = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&ybuf[i]), v16), _mm_set1_ps(CY));
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(&ubuf[i]), v128);
+        __m128 e = _mm_sub_ps(_mm_loadu_ps(&vbuf[i]), v128);
+        __m128 r = _mm_add_ps(c, _mm_mul_ps(e, _mm_set1_ps(CVR)));
+        __m128 g = _mm_add_ps(c, _mm_add_ps(_mm_mul_ps(d, _mm_set1_ps(CUG)), _mm_mul_ps(e, _mm_set1_ps(CVG))));
+        __m128 b = _mm_add_ps(c, _mm_mul_ps(d, _mm_set1_ps(CUB)));
+        r = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(r, vmin), vmax), vgain), vbias);
+        g = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(g, vmin), vmax), vgain), vbias);
+        b = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(b, vmin), vmax), vgain), vbias);
+        store_rgb4(dst + 3 * i, r, g, b);
+    }
+#endif
+    for (; i < dst_width; ++i) {
+        convert_pixel(ybuf[i], ubuf[i], vbuf[i], dst + 3 * i, gain, bias);
+    }
+}
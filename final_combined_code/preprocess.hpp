@@ -0,0 +1,79 @@
+// preprocess.hpp
+#ifndef PREPROCESS_HPP
+#define PREPROCESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Fused YUYV -> RGB + area resize + MobileNetV2 normalization.
+ *
+ * Reads the packed YUYV camera buffer directly and writes the NHWC
+ * float input tensor (x / 127.5 - 1) in a single pass over the
+ * source rows. Each output row is built in three steps that all stay
+ * in L1: vertical area blend of the raw YUYV rows, horizontal area
+ * taps into planar Y/U/V, and the BT.601 colour conversion, which
+ * is vectorised with NEON or SSE2 (scalar fallback otherwise).
+ *
+ * For fully quantized models the normalization and the quantization
+ * are folded into one affine step, so the int8/uint8 tensor is written
+ * straight from the same pass without a float tensor in between.
+ **/
+class YuyvPreprocessor {
+public:
+    YuyvPreprocessor(int dst_width = 224, int dst_height = 224);
+
+    /**
+     * Converts a width x height YUYV image (stride in bytes) into the
+     * dst_width x dst_height x 3 float tensor. width should be even.
+     * A crop of a larger frame is passed as its first byte, its own
+     * size and the frame's stride.
+     **/
+    void toFloatTensor(const uint8_t* yuyv, int width, int height, size_t stride, float* dst);
+
+    /**
+     * Same, for a quantized input tensor: each value is
+     * round(x / scale) + zero_point of the float tensor's x, saturated.
+     **/
+    void toUint8Tensor(const uint8_t* yuyv, int width, int height, size_t stride,
+                       uint8_t* dst, float scale, int zero_point);
+    void toInt8Tensor(const uint8_t* yuyv, int width, int height, size_t stride,
+                      int8_t* dst, float scale, int zero_point);
+
+    int dstWidth() const { return dst_width; }
+    int dstHeight() const { return dst_height; }
+
+private:
+    // Area resampling taps: output i averages source[start[i] .. start[i]+count[i])
+    struct Taps {
+        std::vector<int> start;
+        std::vector<int> count;
+        std::vector<int> offset;
+        std::vector<float> weight;
+    };
+
+    const int dst_width, dst_height;
+    int src_width = 0, src_height = 0;
+    Taps xtaps, ytaps;
+
+    // One vertically blended YUYV row and the planar result of the horizontal pass
+    std::vector<float> vrow;
+    std::vector<float> ybuf, ubuf, vbuf;
+
+    // Converted row before quantization
+    std::vector<float> qrow;
+
+    void configure(int width, int height);
+    void blend_rows(const uint8_t* yuyv, size_t stride, int dy);
+    void resample_row();
+    void convert_row(float* dst, float gain, float bias);
+
+    template<typename T>
+    void to_quantized(const uint8_t* yuyv, int width, int height, size_t stride,
+                      T* dst, float scale, int zero_point, int lo, int hi);
+
+    static void build_taps(Taps& taps, int src, int dst);
+};
+
+#endif // PREPROCESS_HPP
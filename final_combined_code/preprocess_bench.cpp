@@ -0,0 +1,59 @@
+// Times YuyvPreprocessor against the OpenCV path it replaced (cvtColor +
+// resize + normalization loop) on a 640x480 frame. Built and run by make bench.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "preprocess.hpp"
+
+template<typename F>
+static double mean_us(int iterations, F&& run)
+{
+    run();  // warm up caches and scratch buffers
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) run();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 500;
+    const int width = 640, height = 480, size = 224;
+    const size_t stride = static_cast<size_t>(width) * 2;
+
+    std::vector<uint8_t> frame(stride * height);
+    uint32_t seed = 1;
+    for (uint8_t& b : frame) {
+        seed = seed * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(seed >> 24);
+    }
+
+    YuyvPreprocessor preprocessor(size, size);
+    std::vector<float> tensor(static_cast<size_t>(size) * size * 3);
+    std::vector<int8_t> qtensor(tensor.size());
+
+    const double fused = mean_us(iterations, [&] {
+        preprocessor.toFloatTensor(frame.data(), width, height, stride, tensor.data());
+    });
+    const double fused_int8 = mean_us(iterations, [&] {
+        preprocessor.toInt8Tensor(frame.data(), width, height, stride, qtensor.data(), 1.0f / 128, -1);
+    });
+
+    cv::Mat yuyv(height, width, CV_8UC2, frame.data(), stride), rgb, resized;
+    const double opencv = mean_us(iterations, [&] {
+        cv::cvtColor(yuyv, rgb, cv::COLOR_YUV2RGB_YUYV);
+        cv::resize(rgb, resized, cv::Size(size, size), 0, 0, cv::INTER_AREA);
+        const uint8_t* src = resized.ptr<uint8_t>(0);
+        for (size_t k = 0; k < tensor.size(); ++k) tensor[k] = src[k] / 127.5f - 1.0f;
+    });
+
+    std::cout << "640x480 YUYV -> 224x224x3, mean of " << iterations << " runs\n"
+              << "  fused float32 : " << fused << " us\n"
+              << "  fused int8    : " << fused_int8 << " us\n"
+              << "  OpenCV float32: " << opencv << " us\n";
+    return 0;
+}
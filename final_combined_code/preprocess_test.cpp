@@ -0,0 +1,121 @@
+// Checks YuyvPreprocessor against OpenCV: cvtColor(COLOR_YUV2RGB_YUYV) +
+// resize(INTER_AREA) + x / 127.5 - 1, and its int8/uint8 tensors against
+// quantizing its own float tensor. Built and run by make test.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "preprocess.hpp"
+
+// Allowed difference in 8-bit levels. OpenCV converts each pixel with
+// fixed-point BT.601 and rounds to 8 bits before averaging; the kernel
+// averages first and converts in float. Without saturated channels that
+// is worth a fraction of a level on average and a couple at most.
+static const double MAX_LEVELS = 3.0;
+static const double MEAN_LEVELS = 0.5;
+
+// The quantized paths fold normalization and quantization into one
+// affine step, so they may round the other way at a .5 boundary
+static const int MAX_LSB = 1;
+
+// Input quantization of a [-1, 1) tensor in 256 steps
+static const float QUANT_SCALE = 1.0f / 128;
+static const int INT8_ZERO_POINT = -1;
+static const int UINT8_ZERO_POINT = 128;
+
+// Smooth gradients plus noise, chroma kept away from saturation
+static std::vector<uint8_t> make_frame(int width, int height)
+{
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 2);
+    uint32_t seed = 1;
+    auto noise = [&seed](int range) {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<int>((seed >> 16) % (2 * range + 1)) - range;
+    };
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = frame.data() + static_cast<size_t>(y) * width * 2;
+        for (int x = 0; x < width; x += 2) {
+            row[x * 2] = static_cast<uint8_t>(60 + 100 * x / width + 40 * y / height + noise(8));
+            row[x * 2 + 1] = static_cast<uint8_t>(110 + 36 * x / width + noise(4));
+            row[x * 2 + 2] = static_cast<uint8_t>(60 + 100 * (x + 1) / width + 40 * y / height + noise(8));
+            row[x * 2 + 3] = static_cast<uint8_t>(146 - 36 * y / height + noise(4));
+        }
+    }
+    return frame;
+}
+
+// Largest difference between a quantized tensor and round(x / scale) +
+// zero_point of the float one, saturated to [lo, lo + 255]
+template<typename T>
+static int max_lsb(const std::vector<float>& tensor, const std::vector<T>& quantized, int zero_point, int lo)
+{
+    int max_diff = 0;
+    for (size_t k = 0; k < tensor.size(); ++k) {
+        const int q = std::clamp(static_cast<int>(std::lround(tensor[k] / QUANT_SCALE)) + zero_point, lo, lo + 255);
+        max_diff = std::max(max_diff, std::abs(quantized[k] - q));
+    }
+    return max_diff;
+}
+
+struct Case {
+    int x, y, width, height;  // crop of the 640 x 480 frame
+    int dst_width, dst_height;
+};
+
+static bool check(const std::vector<uint8_t>& frame, int frame_width, const Case& c)
+{
+    const size_t stride = static_cast<size_t>(frame_width) * 2;
+    const uint8_t* crop = frame.data() + c.y * stride + c.x * 2;
+
+    cv::Mat yuyv(c.height, c.width, CV_8UC2, const_cast<uint8_t*>(crop), stride);
+    cv::Mat rgb, resized;
+    cv::cvtColor(yuyv, rgb, cv::COLOR_YUV2RGB_YUYV);
+    cv::resize(rgb, resized, cv::Size(c.dst_width, c.dst_height), 0, 0, cv::INTER_AREA);
+
+    YuyvPreprocessor preprocessor(c.dst_width, c.dst_height);
+    std::vector<float> tensor(static_cast<size_t>(c.dst_width) * c.dst_height * 3);
+    preprocessor.toFloatTensor(crop, c.width, c.height, stride, tensor.data());
+
+    double max_diff = 0.0, sum_diff = 0.0;
+    size_t k = 0;
+    for (int y = 0; y < c.dst_height; ++y) {
+        const uint8_t* row = resized.ptr<uint8_t>(y);
+        for (int x = 0; x < c.dst_width * 3; ++x, ++k) {
+            const double diff = std::abs((tensor[k] + 1.0) * 127.5 - row[x]);
+            max_diff = std::max(max_diff, diff);
+            sum_diff += diff;
+        }
+    }
+    const double mean_diff = sum_diff / tensor.size();
+
+    std::vector<int8_t> int8_tensor(tensor.size());
+    std::vector<uint8_t> uint8_tensor(tensor.size());
+    preprocessor.toInt8Tensor(crop, c.width, c.height, stride, int8_tensor.data(), QUANT_SCALE, INT8_ZERO_POINT);
+    preprocessor.toUint8Tensor(crop, c.width, c.height, stride, uint8_tensor.data(), QUANT_SCALE, UINT8_ZERO_POINT);
+    const int int8_lsb = max_lsb(tensor, int8_tensor, INT8_ZERO_POINT, -128);
+    const int uint8_lsb = max_lsb(tensor, uint8_tensor, UINT8_ZERO_POINT, 0);
+
+    const bool ok = max_diff <= MAX_LEVELS && mean_diff <= MEAN_LEVELS && int8_lsb <= MAX_LSB && uint8_lsb <= MAX_LSB;
+    std::cout << (ok ? "ok   " : "FAIL ") << c.width << "x" << c.height << "+" << c.x << "+" << c.y << " -> "
+              << c.dst_width << "x" << c.dst_height << ": max " << max_diff << ", mean " << mean_diff
+              << " levels from OpenCV; int8 " << int8_lsb << ", uint8 " << uint8_lsb
+              << " LSB from quantized float\n";
+    return ok;
+}
+
+int main()
+{
+    const int width = 640, height = 480;
+    const std::vector<uint8_t> frame = make_frame(width, height);
+
+    const Case cases[] = {
+        {0, 0, 640, 480, 224, 224},    // full frame, the MobileNet input
+        {100, 50, 300, 330, 224, 224}, // --roi crop, upscaled one way
+        {0, 0, 640, 480, 96, 96},
+    };
+    bool ok = true;
+    for (const Case& c : cases) ok &= check(frame, width, c);
+    return ok ? 0 : 1;
+}
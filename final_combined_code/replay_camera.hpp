@@ -0,0 +1,288 @@
+// replay_camera.hpp
+#ifndef REPLAY_CAMERA_HPP
+#define REPLAY_CAMERA_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <opencv2/opencv.hpp>
+#include "camera.hpp"
+#include "capture_log.hpp"
+
+/**
+ * BufferSource that replays recorded frames through the same
+ * dequeue/requeue cycle as the V4L2 driver, so StreamingRing and the
+ * rest of the pipeline can run without a webcam. Frames are paced at
+ * `fps` (0 = as fast as possible). Subclasses only fill a buffer with
+ * the next frame.
+ **/
+class ReplaySource : public BufferSource {
+public:
+    ReplaySource(int width, int height, double fps, int num_buffers)
+        : WIDTH(width), HEIGHT(height), frame_bytes(static_cast<size_t>(width) * height * 2),
+          interval_us(fps > 0 ? static_cast<uint64_t>(1e6 / fps) : 0),
+          buffers(num_buffers, std::vector<uint8_t>(frame_bytes))
+    {
+    }
+
+    bool streamOn() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.clear();
+        for (int i = 0; i < static_cast<int>(buffers.size()); ++i) queued.push_back(i);
+        next_due_us = monotonic_us();
+        return true;
+    }
+
+    void streamOff() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.clear();
+    }
+
+    bool dequeue(Buffer& buf, int timeout_ms) override {
+        const uint64_t deadline = monotonic_us() + timeout_ms * 1000ULL;
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // Like the driver: nothing to fill until a buffer is requeued
+            if (!cv_queued.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                    [&] { return !queued.empty(); }))
+                return false;
+            index = queued.front();
+            queued.pop_front();
+        }
+
+        if (interval_us) {
+            if (next_due_us > deadline) {
+                requeue(index);
+                return false;
+            }
+            uint64_t now = monotonic_us();
+            if (next_due_us > now)
+                std::this_thread::sleep_for(std::chrono::microseconds(next_due_us - now));
+            next_due_us += interval_us;
+        }
+
+        if (!read_frame(buffers[index].data())) {
+            requeue(index);
+            return false;
+        }
+
+        buf.index = index;
+        buf.data = buffers[index].data();
+        buf.bytesused = frame_bytes;
+        buf.sequence = sequence++;
+        buf.timestamp_us = monotonic_us();
+        return true;
+    }
+
+    void requeue(int index) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued.push_back(index);
+        }
+        cv_queued.notify_one();
+    }
+
+    int width() const override { return WIDTH; }
+    int height() const override { return HEIGHT; }
+
+protected:
+    const int WIDTH, HEIGHT;
+    const size_t frame_bytes;
+
+    // Copies the next frame (frame_bytes of YUYV) into dst
+    virtual bool read_frame(uint8_t* dst) = 0;
+
+private:
+    const uint64_t interval_us;
+
+    std::vector<std::vector<uint8_t>> buffers;
+    std::deque<int> queued;
+    std::mutex mutex;
+    std::condition_variable cv_queued;
+
+    uint64_t next_due_us = 0;
+    uint32_t sequence = 0;
+};
+
+/**
+ * Back-to-back raw YUYV frames from a file (e.g. a recording of
+ * /dev/video0). Loops at EOF.
+ **/
+class RawFileSource : public ReplaySource {
+public:
+    RawFileSource(const std::string& path, int width = 640, int height = 480,
+                  double fps = 30.0, int num_buffers = 4)
+        : ReplaySource(width, height, fps, num_buffers)
+    {
+        file = fopen(path.c_str(), "rb");
+        if (!file) throw std::runtime_error("Failed to open " + path);
+    }
+
+    ~RawFileSource() override {
+        if (file) fclose(file);
+    }
+
+protected:
+    bool read_frame(uint8_t* dst) override {
+        if (fread(dst, 1, frame_bytes, file) == frame_bytes) return true;
+        rewind(file);
+        return fread(dst, 1, frame_bytes, file) == frame_bytes;
+    }
+
+private:
+    FILE* file = nullptr;
+};
+
+// BGR image -> packed YUYV (BT.601 video range, the inverse of what the camera path decodes)
+inline void bgrToYuyv(const cv::Mat& bgr, uint8_t* dst)
+{
+    for (int y = 0; y < bgr.rows; ++y) {
+        const uint8_t* src = bgr.ptr<uint8_t>(y);
+        for (int x = 0; x + 1 < bgr.cols; x += 2, src += 6, dst += 4) {
+            float b0 = src[0], g0 = src[1], r0 = src[2];
+            float b1 = src[3], g1 = src[4], r1 = src[5];
+            float r = (r0 + r1) * 0.5f, g = (g0 + g1) * 0.5f, b = (b0 + b1) * 0.5f;
+            dst[0] = cv::saturate_cast<uint8_t>(16.0f + 0.257f * r0 + 0.504f * g0 + 0.098f * b0);
+            dst[1] = cv::saturate_cast<uint8_t>(128.0f - 0.148f * r - 0.291f * g + 0.439f * b);
+            dst[2] = cv::saturate_cast<uint8_t>(16.0f + 0.257f * r1 + 0.504f * g1 + 0.098f * b1);
+            dst[3] = cv::saturate_cast<uint8_t>(128.0f + 0.439f * r - 0.368f * g - 0.071f * b);
+        }
+    }
+}
+
+/**
+ * Every JPEG under a directory (recursively, in sorted order), e.g.
+ * model_training/kaggle_new_dataset. The images are decoded, resized
+ * and converted to YUYV once at construction so replay is
+ * deterministic and costs only a memcpy per frame. Loops at the end.
+ **/
+class JpegDirectorySource : public ReplaySource {
+public:
+    JpegDirectorySource(const std::string& directory, int width = 640, int height = 480,
+                        double fps = 30.0, int num_buffers = 4)
+        : ReplaySource(width, height, fps, num_buffers)
+    {
+        std::vector<cv::String> files;
+        cv::glob(directory + "/*.jpg", files, true);
+        std::sort(files.begin(), files.end());
+
+        for (const auto& file : files) {
+            cv::Mat bgr = cv::imread(file, cv::IMREAD_COLOR);
+            if (bgr.empty()) {
+                std::cerr << "Skipping unreadable " << file << "\n";
+                continue;
+            }
+            cv::Mat resized;
+            cv::resize(bgr, resized, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+            frames.emplace_back(frame_bytes);
+            bgrToYuyv(resized, frames.back().data());
+            names.push_back(file);
+        }
+        if (frames.empty()) throw std::runtime_error("No JPEG images in " + directory);
+        std::cout << "Replaying " << frames.size() << " images from " << directory << "\n";
+    }
+
+    const std::vector<std::string>& fileNames() const { return names; }
+
+protected:
+    bool read_frame(uint8_t* dst) override {
+        std::memcpy(dst, frames[next].data(), frame_bytes);
+        next = (next + 1) % frames.size();
+        return true;
+    }
+
+private:
+    std::vector<std::vector<uint8_t>> frames;
+    std::vector<std::string> names;
+    size_t next = 0;
+};
+
+/**
+ * Frames recorded in a capture log (capture_log.hpp), read straight
+ * from the mapping. Loops at the end of the log.
+ **/
+class CaptureLogSource : public ReplaySource {
+public:
+    CaptureLogSource(const std::string& path, int width = 640, int height = 480,
+                     double fps = 30.0, int num_buffers = 4)
+        : ReplaySource(width, height, fps, num_buffers), reader(path)
+    {
+        if (reader.recordCount() == 0) throw std::runtime_error("Empty capture log " + path);
+        std::cout << "Replaying " << reader.recordCount() << " records from " << path << "\n";
+    }
+
+protected:
+    bool read_frame(uint8_t* dst) override {
+        CaptureLogReader::Entry entry;
+        for (uint64_t tries = 0; tries <= reader.recordCount(); ++tries) {
+            if (!reader.next(entry)) {
+                reader.rewind();
+                continue;
+            }
+            if (entry.record->width == WIDTH && entry.record->height == HEIGHT &&
+                entry.record->frame_bytes >= frame_bytes) {
+                std::memcpy(dst, entry.yuyv, frame_bytes);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    CaptureLogReader reader;
+};
+
+/**
+ * Camera backed by a ReplaySource: a raw YUYV recording, a capture
+ * log or a directory of JPEGs. Always streams, so capture() behaves like the
+ * streaming V4L2 camera.
+ **/
+class ReplayCamera : public Camera {
+public:
+    ReplayCamera(std::unique_ptr<ReplaySource> source) : source(std::move(source)) {}
+
+    // A directory is replayed as JPEGs, a capture log as its records,
+    // anything else as a raw YUYV recording
+    static std::unique_ptr<ReplayCamera> open(const std::string& path, double fps = 30.0,
+                                              int width = 640, int height = 480) {
+        struct stat st{};
+        if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            return std::make_unique<ReplayCamera>(std::make_unique<JpegDirectorySource>(path, width, height, fps));
+        if (CaptureLogReader::isCaptureLog(path))
+            return std::make_unique<ReplayCamera>(std::make_unique<CaptureLogSource>(path, width, height, fps));
+        return std::make_unique<ReplayCamera>(std::make_unique<RawFileSource>(path, width, height, fps));
+    }
+
+    ~ReplayCamera() override {
+        ring.reset();
+    }
+
+    bool startStreaming(int affinity = -1, int priority = 0) override {
+        if (!ring) ring = std::make_unique<StreamingRing>(*source);
+        return ring->start(affinity, priority);
+    }
+
+    FramePtr capture() override {
+        if (!ring && !startStreaming()) return nullptr;
+        FramePtr frame = ring->latest();
+        return frame ? frame : ring->waitNewer(0, std::chrono::seconds(2));
+    }
+
+    StreamingRing* streamingRing() override { return ring.get(); }
+
+private:
+    std::unique_ptr<ReplaySource> source;
+    std::unique_ptr<StreamingRing> ring;
+};
+
+#endif // REPLAY_CAMERA_HPP
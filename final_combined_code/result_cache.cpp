@@ -0,0 +1,117 @@
+#include "result_cache.hpp"
+#include <algorithm>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const int GRID_WIDTH = 9;
+static const int GRID_HEIGHT = 8;
+
+// Every other row is plenty for an 8-row grid
+static const int ROW_STEP = 2;
+
+ResultCache::ResultCache(ResultCacheSettings settings) : settings(settings)
+{
+    entries.reserve(settings.capacity);
+}
+
+uint64_t ResultCache::hash(const uint8_t* yuyv, int width, int height, size_t stride)
+{
+    // Y0 + Y1 of every pixel pair, summed down the rows of one grid band
+    thread_local std::vector<uint32_t> columns;
+    const int n = width / 2;
+    columns.resize(n);
+
+    float grid[GRID_HEIGHT][GRID_WIDTH];
+    for (int band = 0; band < GRID_HEIGHT; ++band) {
+        std::fill(columns.begin(), columns.end(), 0);
+        uint32_t* col = columns.data();
+        int rows = 0;
+        for (int y = band * height / GRID_HEIGHT; y < (band + 1) * height / GRID_HEIGHT; y += ROW_STEP, ++rows) {
+            const uint8_t* row = yuyv + static_cast<size_t>(y) * stride;
+            int p = 0;
+#if defined(__ARM_NEON)
+            for (; p + 8 <= n; p += 8) {
+                uint8x8x4_t a = vld4_u8(row + p * 4);
+                uint16x8_t sum = vaddl_u8(a.val[0], a.val[2]);
+                vst1q_u32(col + p, vaddw_u16(vld1q_u32(col + p), vget_low_u16(sum)));
+                vst1q_u32(col + p + 4, vaddw_u16(vld1q_u32(col + p + 4), vget_high_u16(sum)));
+            }
+#elif defined(__SSE2__)
+            // Mask out the chroma, then a multiply-add by one sums each pair's Y0 + Y1
+            const __m128i ymask = _mm_set1_epi16(0x00ff);
+            const __m128i ones = _mm_set1_epi16(1);
+            for (; p + 4 <= n; p += 4) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + p * 4));
+                __m128i sum = _mm_madd_epi16(_mm_and_si128(a, ymask), ones);
+                __m128i* c = reinterpret_cast<__m128i*>(col + p);
+                _mm_storeu_si128(c, _mm_add_epi32(_mm_loadu_si128(c), sum));
+            }
+#endif
+            for (; p < n; ++p) col[p] += row[p * 4] + row[p * 4 + 2];
+        }
+
+        for (int cell = 0; cell < GRID_WIDTH; ++cell) {
+            const int first = cell * n / GRID_WIDTH, last = (cell + 1) * n / GRID_WIDTH;
+            uint64_t sum = 0;
+            for (int p = first; p < last; ++p) sum += col[p];
+            const uint64_t pixels = static_cast<uint64_t>(last - first) * 2 * rows;
+            grid[band][cell] = pixels ? static_cast<float>(sum) / pixels : 0.0f;
+        }
+    }
+
+    uint64_t bits = 0;
+    for (int band = 0; band < GRID_HEIGHT; ++band)
+        for (int cell = 0; cell + 1 < GRID_WIDTH; ++cell)
+            bits = (bits << 1) | (grid[band][cell] < grid[band][cell + 1]);
+    return bits;
+}
+
+bool ResultCache::lookup(uint64_t hash, uint64_t generation, uint64_t now_us, ClassificationResult& result)
+{
+    const uint64_t max_age_us = static_cast<uint64_t>(settings.max_age_ms * 1000.0);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Entry* best = nullptr;
+    int best_distance = settings.max_distance + 1;
+    for (Entry& entry : entries) {
+        if (entry.generation != generation || entry.stored_us + max_age_us < now_us) continue;
+        const int d = distance(hash, entry.hash);
+        if (d < best_distance) {
+            best = &entry;
+            best_distance = d;
+        }
+    }
+    if (!best) {
+        miss_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    best->used = ++clock;
+    result = best->result;
+    hit_count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ResultCache::insert(uint64_t hash, uint64_t generation, uint64_t now_us, const ClassificationResult& result)
+{
+    if (settings.capacity == 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // The same scene again (its entry had expired) refreshes that entry
+    Entry* slot = nullptr;
+    for (Entry& entry : entries) {
+        if (entry.generation == generation && distance(hash, entry.hash) <= settings.max_distance) {
+            slot = &entry;
+            break;
+        }
+    }
+    if (!slot && entries.size() < settings.capacity) slot = &entries.emplace_back();
+    if (!slot) {
+        slot = &*std::min_element(entries.begin(), entries.end(),
+                                  [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    }
+    *slot = {hash, generation, now_us, ++clock, result};
+}
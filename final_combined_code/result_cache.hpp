@@ -0,0 +1,86 @@
+// result_cache.hpp
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "classification.hpp"
+
+struct ResultCacheSettings {
+    size_t capacity = 16;
+
+    // A frame whose hash differs from an entry's in at most this many bits is the same scene
+    int max_distance = 4;
+
+    // Entries older than this are never returned, so a changed scene can't live on
+    double max_age_ms = 2000.0;
+};
+
+/**
+ * Small LRU cache of recent classifications keyed on a 64-bit
+ * difference hash of the frame. When an item stalls under the sensor
+ * or the belt stops, the retriggers see the same scene over and over;
+ * their hashes land within a few bits of the first one and get its
+ * result back without running a model.
+ *
+ * The hash covers the item's box (the whole frame without --roi), so
+ * a new item that looks like the last one could land close to its
+ * hash. Every entry is therefore
+ * tagged with the occupancy generation its item was captured in, and
+ * the capture stage starts a new generation whenever the belt is seen
+ * empty: only retriggers of the item still under the sensor match.
+ *
+ * The preprocess stage looks up and the inference stage inserts, so
+ * both take the lock; with a handful of entries a linear scan is
+ * cheaper than anything indexed.
+ **/
+class ResultCache {
+public:
+    explicit ResultCache(ResultCacheSettings settings = ResultCacheSettings());
+
+    /**
+     * dHash of a width x height YUYV image (stride in bytes): the luma
+     * is area-averaged onto a 9 x 8 grid, and each bit says whether a
+     * cell is darker than its right-hand neighbour. Exposure drift moves
+     * every cell together, so it barely changes the hash.
+     **/
+    static uint64_t hash(const uint8_t* yuyv, int width, int height, size_t stride);
+
+    static int distance(uint64_t a, uint64_t b) { return __builtin_popcountll(a ^ b); }
+
+    // Closest live entry of the generation within max_distance; counts a hit or a miss
+    bool lookup(uint64_t hash, uint64_t generation, uint64_t now_us, ClassificationResult& result);
+
+    // Replaces the least recently used entry when full
+    void insert(uint64_t hash, uint64_t generation, uint64_t now_us, const ClassificationResult& result);
+
+    // The belt was seen empty: entries stored so far are never returned again
+    void newGeneration() { current_generation.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t generation() const { return current_generation.load(std::memory_order_relaxed); }
+
+    uint64_t hits() const { return hit_count.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return miss_count.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint64_t generation;
+        uint64_t stored_us;
+        uint64_t used;               // LRU stamp
+        ClassificationResult result;
+    };
+
+    const ResultCacheSettings settings;
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    uint64_t clock = 0;
+    std::atomic<uint64_t> current_generation{0};
+
+    std::atomic<uint64_t> hit_count{0};
+    std::atomic<uint64_t> miss_count{0};
+};
+
+#endif // RESULT_CACHE_HPP
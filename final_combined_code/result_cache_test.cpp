@@ -0,0 +1,74 @@
+// Checks ResultCache::hash(), whose column sums are SSE2 or NEON, bit for
+// bit against a scalar dHash of the same grid: random frames and crops of
+// them, at widths that leave the vector loops a scalar tail (odd pixel
+// pair counts included) and heights that split unevenly into the bands.
+// Built and run by make test.
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "result_cache.hpp"
+
+static const int GRID_WIDTH = 9, GRID_HEIGHT = 8, ROW_STEP = 2;
+
+// Every band and cell averaged straight from the pixels
+static uint64_t scalar_hash(const uint8_t* yuyv, int width, int height, size_t stride)
+{
+    const int n = width / 2;
+    float grid[GRID_HEIGHT][GRID_WIDTH];
+    for (int band = 0; band < GRID_HEIGHT; ++band) {
+        const int y0 = band * height / GRID_HEIGHT, y1 = (band + 1) * height / GRID_HEIGHT;
+        const int rows = (y1 - y0 + ROW_STEP - 1) / ROW_STEP;
+        for (int cell = 0; cell < GRID_WIDTH; ++cell) {
+            const int first = cell * n / GRID_WIDTH, last = (cell + 1) * n / GRID_WIDTH;
+            uint64_t sum = 0;
+            for (int y = y0; y < y1; y += ROW_STEP)
+                for (int p = first; p < last; ++p) sum += yuyv[y * stride + p * 4] + yuyv[y * stride + p * 4 + 2];
+            const uint64_t pixels = static_cast<uint64_t>(last - first) * 2 * rows;
+            grid[band][cell] = pixels ? static_cast<float>(sum) / pixels : 0.0f;
+        }
+    }
+    uint64_t bits = 0;
+    for (int band = 0; band < GRID_HEIGHT; ++band)
+        for (int cell = 0; cell + 1 < GRID_WIDTH; ++cell)
+            bits = (bits << 1) | (grid[band][cell] < grid[band][cell + 1]);
+    return bits;
+}
+
+int main()
+{
+    const int frame_width = 662, frame_height = 497;
+    const size_t stride = static_cast<size_t>(frame_width) * 2;
+    std::vector<uint8_t> frame(stride * frame_height);
+    uint32_t seed = 1;
+    for (uint8_t& v : frame) {
+        seed = seed * 1664525u + 1013904223u;
+        v = static_cast<uint8_t>(seed >> 24);
+    }
+
+    // Whole frames of each size, then crops at odd pair offsets with the frame's stride
+    struct Case { int x, y, width, height; };
+    std::vector<Case> cases;
+    for (int width : {640, 662, 638, 322, 130, 36, 18, 2})
+        for (int height : {480, 497, 63, 17, 9})
+            cases.push_back({0, 0, width, height});
+    for (int x : {2, 6, 30})
+        for (int width : {190, 222, 98})
+            cases.push_back({x, x * 3 + 1, width, width + 7});
+
+    int mismatches = 0;
+    for (const Case& c : cases) {
+        const uint8_t* crop = frame.data() + c.y * stride + c.x * 2;
+        const uint64_t got = ResultCache::hash(crop, c.width, c.height, stride);
+        const uint64_t expected = scalar_hash(crop, c.width, c.height, stride);
+        if (got != expected) {
+            std::cout << "FAIL " << c.width << "x" << c.height << "+" << c.x << "+" << c.y << ": "
+                      << ResultCache::distance(got, expected) << " bits differ\n";
+            mismatches++;
+        }
+    }
+
+    const bool ok = mismatches == 0;
+    std::cout << (ok ? "ok   " : "FAIL ") << "hash vs scalar: " << mismatches << " of " << cases.size()
+              << " frames and crops differ\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+// sample_filter.hpp
+#ifndef SAMPLE_FILTER_HPP
+#define SAMPLE_FILTER_HPP
+
+#include <cstddef>
+#include <vector>
+#include "sample_ring.hpp"
+
+struct FilterSettings {
+    enum Type { MOVING_AVERAGE, EMA };
+    Type type = MOVING_AVERAGE;
+
+    // Moving average length in samples (32 = 37 ms at 860 Hz)
+    int window = 32;
+
+    // EMA smoothing factor, 0 < alpha <= 1
+    float alpha = 0.05f;
+
+    // One output per this many input samples (43 = 20 Hz at 860 Hz)
+    int decimation = 43;
+};
+
+/**
+ * Low-pass filter (moving average or EMA) followed by decimation.
+ * Runs on batches popped from a SampleRing; every output carries the
+ * timestamp of the newest input it includes.
+ **/
+class DecimatingFilter {
+public:
+    explicit DecimatingFilter(FilterSettings settings = FilterSettings())
+        : settings(settings), history(settings.type == FilterSettings::MOVING_AVERAGE ? settings.window : 0)
+    {
+        if (this->settings.decimation < 1) this->settings.decimation = 1;
+    }
+
+    // Appends the decimated outputs for n input samples to out; returns how many were added
+    size_t process(const Sample* in, size_t n, std::vector<Sample>& out) {
+        const size_t before = out.size();
+        for (size_t i = 0; i < n; ++i) {
+            const float y = filter(in[i].volts);
+            if (++since_output >= settings.decimation) {
+                since_output = 0;
+                out.push_back({in[i].timestamp_us, y});
+            }
+        }
+        return out.size() - before;
+    }
+
+    // Filters one sample without decimating; returns the filtered value
+    float step(float volts) { return filter(volts); }
+
+    // Latest filtered value, whether or not it was output
+    float value() const { return current; }
+
+private:
+    FilterSettings settings;
+    std::vector<float> history;   // moving average window
+    size_t next = 0;
+    size_t filled = 0;
+    double sum = 0.0;
+    float current = 0.0f;
+    bool primed = false;
+    int since_output = 0;
+
+    float filter(float x) {
+        if (settings.type == FilterSettings::EMA || history.empty()) {
+            current = primed ? current + settings.alpha * (x - current) : x;
+            primed = true;
+            return current;
+        }
+        if (filled == history.size()) sum -= history[next];
+        else filled++;
+        history[next] = x;
+        sum += x;
+        next = (next + 1) % history.size();
+        // Recompute once per window so rounding errors in the running sum can't build up
+        if (next == 0 && filled == history.size()) {
+            sum = 0.0;
+            for (float h : history) sum += h;
+        }
+        current = static_cast<float>(sum / filled);
+        return current;
+    }
+};
+
+#endif // SAMPLE_FILTER_HPP
@@ -0,0 +1,49 @@
+// sample_ring.hpp
+#ifndef SAMPLE_RING_HPP
+#define SAMPLE_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include "spsc_queue.hpp"
+
+struct Sample {
+    uint64_t timestamp_us = 0;   // CLOCK_MONOTONIC
+    float volts = 0.0f;
+};
+
+/**
+ * Lock-free hand-over of ADC samples from the driver thread to a
+ * consumer that drains them in batches. Holds a bit over a second at
+ * 860 Hz; if the consumer falls further behind, new samples are dropped
+ * and counted rather than blocking the driver.
+ **/
+class SampleRing {
+public:
+    static constexpr size_t CAPACITY = 1024;
+
+    // Runs on the producer's thread for every sample, before it is queued
+    using Watcher = std::function<void(const Sample&)>;
+
+    // Set before the producer starts
+    void watch(Watcher w) { watcher = std::move(w); }
+
+    void push(const Sample& sample) {
+        if (watcher) watcher(sample);
+        if (!queue.tryPush(sample)) overrun_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Everything queued so far, up to max; returns the number of samples
+    size_t popBatch(Sample* dst, size_t max) { return queue.tryPopBatch(dst, max); }
+
+    uint64_t overruns() const { return overrun_count.load(std::memory_order_relaxed); }
+
+private:
+    SpscQueue<Sample, CAPACITY> queue;
+    std::atomic<uint64_t> overrun_count{0};
+    Watcher watcher;
+};
+
+#endif // SAMPLE_RING_HPP
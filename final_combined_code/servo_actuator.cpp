@@ -0,0 +1,245 @@
+#include "servo_actuator.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <pthread.h>
+#include <time.h>
+
+static uint64_t now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+ServoActuator::ServoActuator(PwmOutput& bio_gate, PwmOutput& non_bio_gate, MotionProfile bio, MotionProfile non_bio)
+{
+    gates[0].pwm = &bio_gate;
+    gates[0].profile = bio;
+    gates[1].pwm = &non_bio_gate;
+    gates[1].profile = non_bio;
+    sem_init(&wake, 0, 0);
+}
+
+ServoActuator::~ServoActuator()
+{
+    stop();
+    sem_destroy(&wake);
+}
+
+void ServoActuator::start(int affinity, int priority)
+{
+    if (running) return;
+    running = true;
+
+    // Hold both gates at rest for a second, then stop the pulses
+    const uint64_t now = now_us();
+    for (Gate& gate : gates) {
+        gate.pwm->write(gate.profile.rest_pulse);
+        gate.stage = Stage::Homing;
+        gate.due_us = now + 1000000;
+    }
+    thr = std::thread(&ServoActuator::worker, this, affinity, priority);
+}
+
+void ServoActuator::stop()
+{
+    if (!running) return;
+    running = false;
+    sem_post(&wake);
+    thr.join();
+}
+
+bool ServoActuator::submit(const SortCommand& command)
+{
+    if (halted() || command.target == WasteClass::UNKNOWN || !commands.tryPush({command, now_us()})) {
+        rejected++;
+        return false;
+    }
+    submitted++;
+    sem_post(&wake);
+    return true;
+}
+
+void ServoActuator::halt()
+{
+    halt_requested.store(true, std::memory_order_release);
+    sem_post(&wake);
+}
+
+void ServoActuator::resume()
+{
+    halt_requested.store(false, std::memory_order_release);
+    sem_post(&wake);
+}
+
+void ServoActuator::worker(int affinity, int priority)
+{
+    if (affinity >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(affinity, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+            perror("Failed to set actuator thread affinity");
+    }
+    if (priority > 0) {
+        sched_param sch_params;
+        sch_params.sched_priority = priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch_params) != 0)
+            perror("Failed to set actuator thread priority");
+    }
+
+    auto busy = [this] {
+        for (const Gate& gate : gates)
+            if (gate.stage != Stage::Idle) return true;
+        return false;
+    };
+
+    // Keep going after stop() until both gates are back at rest
+    while (running || busy()) {
+        uint64_t now = now_us();
+        const bool halt = halt_requested.load(std::memory_order_acquire);
+        if (halt != gates_halted) applyHalt(halt, now);
+
+        Queued queued;
+        while (commands.tryPop(queued)) {
+            if (!running) {
+                submitted--;
+                continue;
+            }
+            if (gates_halted) {
+                abort(queued, 0, now);
+                continue;
+            }
+            gates[queued.command.target == WasteClass::BIODEGRADABLE ? 0 : 1].waiting.push_back(queued);
+        }
+
+        uint64_t next_due = 0;
+        for (Gate& gate : gates) {
+            if (gate.stage != Stage::Idle && gate.due_us <= now) step(gate, now);
+            if (gate.stage == Stage::Idle && !gate.waiting.empty() && running) begin(gate, now);
+            if (gate.stage != Stage::Idle && (next_due == 0 || gate.due_us < next_due)) next_due = gate.due_us;
+        }
+
+        if (next_due == 0) {
+            if (!running) break;
+            while (sem_wait(&wake) != 0 && errno == EINTR) {}
+            continue;
+        }
+
+        // sem_timedwait only takes CLOCK_REALTIME, so convert the monotonic deadline
+        now = now_us();
+        if (next_due <= now) continue;
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        uint64_t ns = deadline.tv_nsec + (next_due - now) * 1000ULL;
+        deadline.tv_sec += ns / 1000000000ULL;
+        deadline.tv_nsec = ns % 1000000000ULL;
+        sem_timedwait(&wake, &deadline);
+    }
+
+    for (Gate& gate : gates) {
+        submitted -= gate.waiting.size();
+        gate.waiting.clear();
+    }
+}
+
+void ServoActuator::applyHalt(bool halt, uint64_t now)
+{
+    gates_halted = halt;
+    for (Gate& gate : gates) {
+        if (!halt) {
+            // Position unknown after a halt, so home before the next sweep
+            gate.pwm->write(gate.profile.rest_pulse);
+            gate.stage = Stage::Homing;
+            gate.due_us = now + 1000000;
+            continue;
+        }
+
+        gate.pwm->write(0);
+        switch (gate.stage) {
+        case Stage::Opening:
+        case Stage::Dwell:
+        case Stage::Closing:
+            abort(gate.active, gate.started_us, now);
+            break;
+        case Stage::Settling:
+            // Already back at rest
+            completed++;
+            report(SortEvent::Completed, gate, now);
+            break;
+        default:
+            break;
+        }
+        gate.stage = Stage::Idle;
+        for (const Queued& waiting : gate.waiting) abort(waiting, 0, now);
+        gate.waiting.clear();
+    }
+}
+
+// Aborted commands no longer count as outstanding
+void ServoActuator::abort(const Queued& queued, uint64_t started_us, uint64_t now)
+{
+    submitted--;
+    aborted++;
+    if (event_callback) event_callback({SortEvent::Aborted, queued.command, queued.queued_us, started_us, now});
+}
+
+void ServoActuator::begin(Gate& gate, uint64_t now)
+{
+    gate.active = gate.waiting.front();
+    gate.waiting.pop_front();
+    gate.stage = Stage::Opening;
+    gate.pulse = gate.profile.rest_pulse;
+    gate.started_us = now;
+    gate.due_us = now;
+}
+
+void ServoActuator::step(Gate& gate, uint64_t now)
+{
+    const MotionProfile& p = gate.profile;
+    const int dir = p.open_pulse > p.rest_pulse ? 1 : -1;
+
+    switch (gate.stage) {
+    case Stage::Opening:
+        gate.pwm->write(gate.pulse);
+        if (gate.pulse == p.open_pulse) {
+            gate.stage = Stage::Dwell;
+            gate.due_us += p.step_us + p.dwell_us;
+            report(SortEvent::Opened, gate, now);
+        } else {
+            gate.pulse += dir;
+            gate.due_us += p.step_us;
+        }
+        break;
+    case Stage::Dwell:
+        gate.stage = Stage::Closing;
+        gate.pulse = p.open_pulse;
+        [[fallthrough]];
+    case Stage::Closing:
+        gate.pwm->write(gate.pulse);
+        if (gate.pulse == p.rest_pulse) gate.stage = Stage::Settling;
+        else gate.pulse -= dir;
+        gate.due_us += p.step_us;
+        break;
+    case Stage::Homing:
+        gate.pwm->write(0);
+        gate.stage = Stage::Idle;
+        break;
+    case Stage::Settling:
+        // Stop pulsing once at rest so the servo doesn't jitter
+        gate.pwm->write(0);
+        gate.stage = Stage::Idle;
+        completed++;
+        report(SortEvent::Completed, gate, now);
+        break;
+    case Stage::Idle:
+        break;
+    }
+}
+
+void ServoActuator::report(SortEvent::Phase phase, const Gate& gate, uint64_t now)
+{
+    if (!event_callback) return;
+    event_callback({phase, gate.active.command, gate.active.queued_us, gate.started_us, now});
+}
@@ -0,0 +1,134 @@
+// servo_actuator.hpp
+#ifndef SERVO_ACTUATOR_HPP
+#define SERVO_ACTUATOR_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <semaphore.h>
+#include <thread>
+#include "classification.hpp"
+#include "hal.hpp"
+#include "spsc_queue.hpp"
+
+// Gate motion: step the pulse from rest to open, hold, step back, then stop the PWM
+struct MotionProfile {
+    int rest_pulse;
+    int open_pulse;
+    uint32_t step_us = 30000;
+    uint32_t dwell_us = 1000000;
+};
+
+// The sweeps servo.cpp has always done
+inline MotionProfile defaultProfile(WasteClass target) {
+    if (target == WasteClass::BIODEGRADABLE) return {15, 23};
+    return {17, 9};
+}
+
+struct SortCommand {
+    uint64_t id = 0;
+    uint64_t timestamp_us = 0;   // when the item was captured (CLOCK_MONOTONIC)
+    WasteClass target = WasteClass::UNKNOWN;
+};
+
+struct SortEvent {
+    enum Phase { Opened, Completed, Aborted };
+
+    Phase phase;
+    SortCommand command;
+    uint64_t queued_us;          // when submit() accepted the command
+    uint64_t started_us;         // when the gate started to move, 0 if it never did
+    uint64_t at_us;              // when this phase was reached
+};
+
+/**
+ * Owns both servos on a dedicated thread so sorting never blocks the
+ * caller. submit() pushes a SortCommand onto a lock-free queue and
+ * returns straight away; the thread steps each gate through its
+ * MotionProfile with absolute sleeps. The two gates move independently,
+ * commands for a gate that is already moving wait their turn.
+ *
+ * The callback runs on the actuator thread, once when a gate is fully
+ * open (the item has been released) and once when it is back at rest.
+ * start() first drives both gates to rest, as set_servoN_initial() did.
+ *
+ * halt() stops both gates where they are (no more pulses) and aborts
+ * every command, reporting each as Aborted; resume() drives the gates
+ * back to rest and accepts commands again. Both only signal the
+ * actuator thread, so any thread may call them.
+ **/
+class ServoActuator {
+public:
+    using EventCallback = std::function<void(const SortEvent&)>;
+
+    ServoActuator(PwmOutput& bio_gate, PwmOutput& non_bio_gate,
+                  MotionProfile bio = defaultProfile(WasteClass::BIODEGRADABLE),
+                  MotionProfile non_bio = defaultProfile(WasteClass::NONBIODEGRADABLE));
+    ~ServoActuator();
+
+    ServoActuator(const ServoActuator&) = delete;
+    ServoActuator& operator=(const ServoActuator&) = delete;
+
+    void onEvent(EventCallback callback) { event_callback = std::move(callback); }
+
+    void start(int affinity = -1, int priority = 0);
+    // Finishes the motions in progress, drops anything still queued
+    void stop();
+
+    // Single producer. False if halted, the queue is full or the target has no gate.
+    bool submit(const SortCommand& command);
+
+    void halt();
+    void resume();
+    bool halted() const { return halt_requested.load(std::memory_order_acquire); }
+
+    // Commands accepted but not yet back at rest
+    uint32_t outstanding() const { return submitted - completed; }
+    uint64_t completedCount() const { return completed; }
+    uint64_t rejectedCount() const { return rejected; }
+    uint64_t abortedCount() const { return aborted; }
+
+private:
+    struct Queued {
+        SortCommand command;
+        uint64_t queued_us;
+    };
+
+    enum class Stage { Idle, Homing, Opening, Dwell, Closing, Settling };
+
+    struct Gate {
+        PwmOutput* pwm = nullptr;
+        MotionProfile profile;
+        std::deque<Queued> waiting;
+        Queued active{};
+        Stage stage = Stage::Idle;
+        int pulse = 0;
+        uint64_t started_us = 0;
+        uint64_t due_us = 0;
+    };
+
+    SpscQueue<Queued, 16> commands;
+    sem_t wake;
+    Gate gates[2];
+
+    std::thread thr;
+    std::atomic<bool> running{false};
+    std::atomic<bool> halt_requested{false};
+    bool gates_halted = false;   // actuator thread's view
+    EventCallback event_callback;
+
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> aborted{0};
+
+    void worker(int affinity, int priority);
+    void begin(Gate& gate, uint64_t now);
+    void step(Gate& gate, uint64_t now);
+    void applyHalt(bool halt, uint64_t now);
+    void abort(const Queued& queued, uint64_t started_us, uint64_t now);
+    void report(SortEvent::Phase phase, const Gate& gate, uint64_t now);
+};
+
+#endif // SERVO_ACTUATOR_HPP
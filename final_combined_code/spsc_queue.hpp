@@ -0,0 +1,74 @@
+// spsc_queue.hpp
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and one
+ * consumer thread. Capacity must be a power of two. Neither side ever
+ * blocks: tryPush() fails when full and tryPop() when empty.
+ **/
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool tryPush(const T& item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head_cache == Capacity) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t - head_cache == Capacity) return false;
+        }
+        slots[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail_cache) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (h == tail_cache) return false;
+        }
+        // Move out so the slot doesn't keep the item alive (e.g. a shared_ptr)
+        item = std::move(slots[h & (Capacity - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to max items in one go, with a single index update; returns how many
+    size_t tryPopBatch(T* items, size_t max) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        size_t available = tail_cache - h;
+        if (available < max) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            available = tail_cache - h;
+        }
+        const size_t n = available < max ? available : max;
+        for (size_t i = 0; i < n; ++i)
+            items[i] = std::move(slots[(h + i) & (Capacity - 1)]);
+        if (n) head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Approximate when called while the other side is active
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> slots{};
+
+    // Producer and consumer indices on separate cache lines, each with a
+    // private copy of the other side's index to avoid needless cache traffic
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t head_cache = 0;
+    alignas(64) std::atomic<size_t> head{0};
+    size_t tail_cache = 0;
+};
+
+#endif // SPSC_QUEUE_HPP
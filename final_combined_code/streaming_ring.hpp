@@ -0,0 +1,158 @@
+// streaming_ring.hpp
+#ifndef STREAMING_RING_HPP
+#define STREAMING_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+#include <time.h>
+#include "frame.hpp"
+
+// Microseconds on CLOCK_MONOTONIC, the clock V4L2 stamps its buffers with
+inline uint64_t monotonic_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/**
+ * A set of N buffers owned by a driver (or a fake one) that are
+ * dequeued when filled and must be requeued after use.
+ **/
+class BufferSource {
+public:
+    struct Buffer {
+        int index = -1;
+        const uint8_t* data = nullptr;
+        size_t bytesused = 0;
+        uint32_t sequence = 0;
+        uint64_t timestamp_us = 0;
+    };
+
+    virtual ~BufferSource() = default;
+
+    // Queues every buffer and starts the stream
+    virtual bool streamOn() = 0;
+    virtual void streamOff() = 0;
+
+    // Waits up to timeout_ms for a filled buffer; false on timeout or error
+    virtual bool dequeue(Buffer& buf, int timeout_ms) = 0;
+    virtual void requeue(int index) = 0;
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+};
+
+/**
+ * Keeps a BufferSource streaming on a dedicated thread. Every filled
+ * buffer is copied into a pooled Frame and requeued straight away, so
+ * the driver always has buffers to fill and latest() can hand out the
+ * most recent exposure without waiting for a frame interval.
+ **/
+class StreamingRing {
+public:
+    StreamingRing(BufferSource& source, size_t pool_size = 6)
+        : source(source),
+          pool(pool_size, static_cast<size_t>(source.width()) * source.height() * 2)
+    {
+    }
+
+    ~StreamingRing() { stop(); }
+
+    bool start(int affinity = -1, int priority = 0) {
+        if (running) return true;
+        if (!source.streamOn()) return false;
+        running = true;
+        thr = std::thread(&StreamingRing::worker, this, affinity, priority);
+        return true;
+    }
+
+    void stop() {
+        if (!running) return;
+        running = false;
+        thr.join();
+        source.streamOff();
+    }
+
+    // Most recent frame, nullptr before the first one arrives
+    FramePtr latest() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return newest;
+    }
+
+    // Blocks until a frame stamped after `timestamp_us` arrives, nullptr on timeout
+    FramePtr waitNewer(uint64_t timestamp_us, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv_frame.wait_for(lock, timeout, [&] { return newest && newest->timestamp_us > timestamp_us; }))
+            return nullptr;
+        return newest;
+    }
+
+    uint64_t framesReceived() const { return received; }
+    uint64_t framesDropped() const { return dropped; }
+
+private:
+    BufferSource& source;
+    FramePool pool;
+    std::thread thr;
+    std::atomic<bool> running{false};
+
+    std::mutex mutex;
+    std::condition_variable cv_frame;
+    FramePtr newest;
+
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> dropped{0};
+
+    void worker(int affinity, int priority) {
+        if (affinity >= 0) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(affinity, &cpuset);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+                perror("Failed to set streaming thread affinity");
+        }
+        if (priority > 0) {
+            sched_param sch_params;
+            sch_params.sched_priority = priority;
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch_params) != 0)
+                perror("Failed to set streaming thread priority");
+        }
+
+        while (running) {
+            BufferSource::Buffer buf;
+            if (!source.dequeue(buf, 500)) continue;
+            received++;
+
+            // Drop the frame rather than stall the driver if consumers hold every pooled frame
+            std::shared_ptr<Frame> frame = pool.acquire();
+            if (frame) {
+                frame->width = source.width();
+                frame->height = source.height();
+                frame->sequence = buf.sequence;
+                frame->timestamp_us = buf.timestamp_us;
+                frame->bytesused = std::min(buf.bytesused, frame->data.size());
+                std::memcpy(frame->data.data(), buf.data, frame->bytesused);
+            } else {
+                dropped++;
+            }
+            source.requeue(buf.index);
+
+            if (frame) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    newest = std::move(frame);
+                }
+                cv_frame.notify_all();
+            }
+        }
+    }
+};
+
+#endif // STREAMING_RING_HPP
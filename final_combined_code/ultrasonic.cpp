@@ -0,0 +1,103 @@
+#include "ultrasonic.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <time.h>
+
+// Speed of sound, cm per microsecond
+static const double SOUND_CM_PER_US = 0.0343;
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+bool SimulatedEchoLine::trigger()
+{
+    // Like the HC-SR04: the echo pulse starts ~0.5 ms after the trigger
+    const uint64_t now_ns = clock_ns(CLOCK_MONOTONIC);
+    const float cm = distance_cm ? distance_cm(now_ns / 1000) : fixed_cm.load();
+    pending.clear();
+    if (!std::isfinite(cm) || cm < 0.0f || cm > 400.0f) return true;
+
+    const uint64_t rise_ns = now_ns + 500000;
+    const uint64_t width_ns = static_cast<uint64_t>(cm * 2.0 / SOUND_CM_PER_US * 1000.0);
+    pending.push_back({true, rise_ns});
+    pending.push_back({false, rise_ns + width_ns});
+    return true;
+}
+
+bool SimulatedEchoLine::waitEdge(Edge& edge, uint64_t timeout_us)
+{
+    const uint64_t now_ns = clock_ns(CLOCK_MONOTONIC);
+    const uint64_t deadline_ns = now_ns + timeout_us * 1000;
+    if (pending.empty() || pending.front().timestamp_ns > deadline_ns) {
+        if (timeout_us) std::this_thread::sleep_for(std::chrono::microseconds(timeout_us));
+        return false;
+    }
+    if (pending.front().timestamp_ns > now_ns)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(pending.front().timestamp_ns - now_ns));
+    edge = pending.front();
+    pending.pop_front();
+    return true;
+}
+
+UltrasonicRanger::UltrasonicRanger(std::unique_ptr<EchoLine> line, UltrasonicSettings settings)
+    : line(std::move(line)), settings(settings)
+{
+    readings.reserve(std::max(settings.samples, 1));
+}
+
+float UltrasonicRanger::ping()
+{
+    EchoLine::Edge edge;
+    // Drop edges left over from an earlier ping that timed out
+    while (line->waitEdge(edge, 0)) {}
+
+    ping_count++;
+    if (!line->trigger()) {
+        timeout_count++;
+        return NO_ECHO;
+    }
+
+    const uint64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    const uint64_t timeout_ns = settings.timeout_us * 1000;
+    uint64_t rise_ns = 0;
+    for (;;) {
+        const uint64_t elapsed_ns = clock_ns(CLOCK_MONOTONIC) - start_ns;
+        if (elapsed_ns >= timeout_ns || !line->waitEdge(edge, (timeout_ns - elapsed_ns) / 1000)) {
+            timeout_count++;
+            return NO_ECHO;
+        }
+        if (edge.rising) {
+            rise_ns = edge.timestamp_ns;
+        } else if (rise_ns) {
+            return (edge.timestamp_ns - rise_ns) / 1000.0 * SOUND_CM_PER_US / 2.0;
+        }
+    }
+}
+
+float UltrasonicRanger::measure()
+{
+    const uint64_t cpu_start_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+
+    readings.clear();
+    for (int i = 0; i < settings.samples; ++i) {
+        if (i > 0) std::this_thread::sleep_for(std::chrono::microseconds(settings.ping_interval_us));
+        float cm = ping();
+        if (cm != NO_ECHO) readings.push_back(cm);
+    }
+
+    float result = NO_ECHO;
+    if (!readings.empty()) {
+        auto mid = readings.begin() + readings.size() / 2;
+        std::nth_element(readings.begin(), mid, readings.end());
+        result = *mid;
+    }
+
+    last_cpu_us = (clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start_ns) / 1000.0;
+    return result;
+}
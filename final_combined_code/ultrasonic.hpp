@@ -0,0 +1,104 @@
+// ultrasonic.hpp
+#ifndef ULTRASONIC_HPP
+#define ULTRASONIC_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * TRIG/ECHO pair of an HC-SR04 style sensor. trigger() sends the
+ * start pulse, waitEdge() blocks (without spinning) until the echo
+ * line changes and returns the edge with its timestamp. The real
+ * sensor (GPIO edge events through libgpiod) is in hal_rpi.cpp.
+ **/
+class EchoLine {
+public:
+    struct Edge {
+        bool rising = false;
+        uint64_t timestamp_ns = 0;
+    };
+
+    virtual ~EchoLine() = default;
+
+    virtual bool trigger() = 0;
+
+    // False if no edge arrives within timeout_us
+    virtual bool waitEdge(Edge& edge, uint64_t timeout_us) = 0;
+};
+
+/**
+ * Software model of the sensor for tests and replay runs. Each
+ * trigger() produces a rising edge after a short delay and a falling
+ * edge after the round-trip time for the current distance, and
+ * waitEdge() sleeps until they are due. The distance is either fixed
+ * or given by distance_cm(now_us) at trigger time; one that is not
+ * finite (or beyond range) produces no echo at all, like a missed ping.
+ **/
+class SimulatedEchoLine : public EchoLine {
+public:
+    using DistanceFunction = std::function<float(uint64_t now_us)>;
+
+    explicit SimulatedEchoLine(float distance_cm = 100.0f) : fixed_cm(distance_cm) {}
+    explicit SimulatedEchoLine(DistanceFunction distance_cm) : distance_cm(std::move(distance_cm)) {}
+
+    // For the constant-distance form
+    void setDistance(float cm) { fixed_cm = cm; }
+
+    bool trigger() override;
+    bool waitEdge(Edge& edge, uint64_t timeout_us) override;
+
+private:
+    std::atomic<float> fixed_cm{100.0f};
+    DistanceFunction distance_cm;
+    std::deque<Edge> pending;
+};
+
+struct UltrasonicSettings {
+    // Pings per measurement; the result is their median
+    int samples = 3;
+
+    // No echo after this long means nothing in range (~5 m round trip)
+    uint64_t timeout_us = 30000;
+
+    // Pause between pings so a late echo can't be taken for the next one
+    uint64_t ping_interval_us = 10000;
+};
+
+/**
+ * Median-of-N ranging on top of an EchoLine. measure() sleeps in the
+ * kernel while waiting for edges, so a measurement costs a few
+ * syscalls of CPU time however long the echo takes.
+ **/
+class UltrasonicRanger {
+public:
+    static constexpr float NO_ECHO = std::numeric_limits<float>::infinity();
+
+    UltrasonicRanger(std::unique_ptr<EchoLine> line, UltrasonicSettings settings = UltrasonicSettings());
+
+    // Distance in cm, NO_ECHO if none of the pings came back
+    float measure();
+
+    uint64_t pings() const { return ping_count; }
+    uint64_t timeouts() const { return timeout_count; }
+
+    // CPU time the calling thread spent in the last measure()
+    double lastCpuUs() const { return last_cpu_us; }
+
+private:
+    std::unique_ptr<EchoLine> line;
+    const UltrasonicSettings settings;
+    std::vector<float> readings;
+
+    std::atomic<uint64_t> ping_count{0};
+    std::atomic<uint64_t> timeout_count{0};
+    std::atomic<double> last_cpu_us{0.0};
+
+    float ping();
+};
+
+#endif // ULTRASONIC_HPP
@@ -0,0 +1,101 @@
+# Float32 vs full-integer model: invoke latency and top-1 agreement on the sample images
+#   python benchmark_int8.py [float model] [int8 model] [image directory] [threads]
+# Inputs here come from PIL; make compare in final_combined_code runs the same
+# agreement check through the camera's YUYV preprocessing (int8_compare.cpp).
+import json
+import os
+import sys
+import time
+import numpy as np
+from PIL import Image
+
+try:
+    import tflite_runtime.interpreter as tflite
+except ImportError:
+    import tensorflow.lite as tflite
+
+FLOAT_MODEL = sys.argv[1] if len(sys.argv) > 1 else 'model_new_kaggle_dataset.tflite'
+INT8_MODEL = sys.argv[2] if len(sys.argv) > 2 else 'model_new_kaggle_dataset_int8.tflite'
+IMAGE_DIR = sys.argv[3] if len(sys.argv) > 3 else 'kaggle_new_dataset'
+THREADS = int(sys.argv[4]) if len(sys.argv) > 4 else 1
+IMAGE_SIZE = (224, 224)
+WARMUP = 3
+RUNS = 20
+
+# ---- Sample images, preprocessed like predict_tflite.py ----
+def load_images(directory):
+    images = []
+    for root, _, files in sorted(os.walk(directory)):
+        for name in sorted(files):
+            if name.lower().endswith(('.jpg', '.jpeg', '.png')):
+                path = os.path.join(root, name)
+                img = Image.open(path).convert('RGB').resize(IMAGE_SIZE)
+                images.append((path, np.array(img).astype(np.float32) / 127.5 - 1.0))
+    return images
+
+class Model:
+    def __init__(self, path):
+        self.interpreter = tflite.Interpreter(model_path=path, num_threads=THREADS)
+        self.interpreter.allocate_tensors()
+        self.input = self.interpreter.get_input_details()[0]
+        self.output = self.interpreter.get_output_details()[0]
+
+    # Float input quantized with the model's own scale and zero point, as the C++ preprocessor does
+    def set_input(self, x):
+        dtype = self.input['dtype']
+        if dtype != np.float32:
+            scale, zero_point = self.input['quantization']
+            info = np.iinfo(dtype)
+            x = np.clip(np.round(x / scale) + zero_point, info.min, info.max)
+        self.interpreter.set_tensor(self.input['index'], np.expand_dims(x.astype(dtype), axis=0))
+
+    def probabilities(self):
+        y = self.interpreter.get_tensor(self.output['index'])[0]
+        if self.output['dtype'] != np.float32:
+            scale, zero_point = self.output['quantization']
+            y = (y.astype(np.float32) - zero_point) * scale
+        return y
+
+    # Top-1 and invoke times in ms
+    def run(self, x):
+        self.set_input(x)
+        for _ in range(WARMUP):
+            self.interpreter.invoke()
+        times = []
+        for _ in range(RUNS):
+            start = time.perf_counter()
+            self.interpreter.invoke()
+            times.append((time.perf_counter() - start) * 1000)
+        p = self.probabilities()
+        return int(np.argmax(p)), float(np.max(p)), times
+
+images = load_images(IMAGE_DIR)
+if not images:
+    sys.exit(f"No images under {IMAGE_DIR}")
+
+models = {'float32': Model(FLOAT_MODEL), 'int8': Model(INT8_MODEL)}
+times = {name: [] for name in models}
+agree = 0
+for path, x in images:
+    results = {}
+    for name, model in models.items():
+        top, confidence, t = model.run(x)
+        results[name] = (top, confidence)
+        times[name] += t
+    same = results['float32'][0] == results['int8'][0]
+    agree += same
+    print(f"{os.path.basename(path)}: float32 {results['float32'][0]} ({results['float32'][1]:.3f})"
+          f"  int8 {results['int8'][0]} ({results['int8'][1]:.3f}){'' if same else '  DIFFERENT'}")
+
+summary = {'images': len(images), 'threads': THREADS, 'top1_agreement': agree / len(images)}
+for name, t in times.items():
+    t = np.array(t)
+    summary[name] = {
+        'model': FLOAT_MODEL if name == 'float32' else INT8_MODEL,
+        'size_kb': os.path.getsize(FLOAT_MODEL if name == 'float32' else INT8_MODEL) // 1024,
+        'mean_ms': round(float(t.mean()), 3),
+        'p50_ms': round(float(np.percentile(t, 50)), 3),
+        'p95_ms': round(float(np.percentile(t, 95)), 3),
+    }
+summary['speedup'] = round(summary['float32']['p50_ms'] / summary['int8']['p50_ms'], 2)
+print(json.dumps(summary, indent=2))
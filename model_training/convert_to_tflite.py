@@ -1,15 +1,47 @@
+import sys
 import tensorflow as tf
+from tensorflow.keras.applications.mobilenet_v2 import preprocess_input
+
+# python convert_to_tflite.py          -> float32 model
+# python convert_to_tflite.py --int8   -> full-integer (int8) model, calibrated on the training images
+INT8 = '--int8' in sys.argv
+CALIBRATION_DIR = 'kaggle_new_dataset'
+CALIBRATION_IMAGES = 300
+IMAGE_SIZE = (224, 224)
 
 # Load the .h5 model
 # model = tf.keras.models.load_model('retrained_model.h5')
 model = tf.keras.models.load_model('retrained_model_new_kaggle_dataset.h5')
 
+# ---- Representative dataset: same loading and preprocessing as training ----
+def representative_dataset():
+    images = tf.keras.preprocessing.image_dataset_from_directory(
+        CALIBRATION_DIR,
+        image_size=IMAGE_SIZE,
+        batch_size=1,
+        label_mode=None,
+        shuffle=True,
+        seed=0
+    )
+    for image in images.take(CALIBRATION_IMAGES):
+        yield [preprocess_input(tf.cast(image, tf.float32))]
+
 # Convert to TFLite
 converter = tf.lite.TFLiteConverter.from_keras_model(model)
+output_path = 'model_new_kaggle_dataset.tflite'
+if INT8:
+    # Weights and activations in int8, and int8 input/output so the C++
+    # classifier writes the input tensor straight from the camera frame
+    converter.optimizations = [tf.lite.Optimize.DEFAULT]
+    converter.representative_dataset = representative_dataset
+    converter.target_spec.supported_ops = [tf.lite.OpsSet.TFLITE_BUILTINS_INT8]
+    converter.inference_input_type = tf.int8
+    converter.inference_output_type = tf.int8
+    output_path = 'model_new_kaggle_dataset_int8.tflite'
 tflite_model = converter.convert()
 
 # Save the TFLite model
-with open('model_new_kaggle_dataset.tflite', 'wb') as f:
+with open(output_path, 'wb') as f:
     f.write(tflite_model)
 
-print("? Converted model saved as model_new_kaggle_dataset.tflite")
+print(f"? Converted model saved as {output_path}")
@@ -0,0 +1,113 @@
+# Trains the colour/texture pre-classifier that runs before MobileNetV2
+# (final_combined_code/color_prefilter.hpp) and writes its weights file.
+#   python train_prefilter.py [image directory] [weights file]
+# Copy the weights next to the model and start the system with --prefilter <weights file>.
+import os
+import sys
+import numpy as np
+from PIL import Image
+
+# ---- Configuration ----
+TRAIN_DIR = sys.argv[1] if len(sys.argv) > 1 else 'kaggle_new_dataset'
+WEIGHTS_SAVE_PATH = sys.argv[2] if len(sys.argv) > 2 else 'prefilter_weights.txt'
+LABELS_PATH = 'labels.txt'
+CAMERA_SIZE = (640, 480)      # features are computed on camera frames, so match their scale
+ROW_STEP = 4                  # ColorPrefilter::ROW_STEP
+EPOCHS = 2000
+LEARNING_RATE = 0.5
+L2 = 1e-3
+VALIDATION_SPLIT = 0.2
+
+# ---- RGB image -> packed YUYV, BT.601 video range like the camera ----
+def to_yuyv(path):
+    rgb = np.asarray(Image.open(path).convert('RGB').resize(CAMERA_SIZE), dtype=np.float32)
+    r, g, b = rgb[..., 0], rgb[..., 1], rgb[..., 2]
+    y = 16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255
+    u = 128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255
+    v = 128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255
+    # 4:2:2, one U and V per horizontal pixel pair
+    u = (u[:, 0::2] + u[:, 1::2]) / 2
+    v = (v[:, 0::2] + v[:, 1::2]) / 2
+    quantize = lambda a: np.clip(np.round(a), 0, 255).astype(np.int32)
+    return quantize(y), quantize(u), quantize(v)
+
+# ---- Same features as ColorPrefilter::features ----
+def features(path):
+    y, u, v = to_yuyv(path)
+    rows = np.arange(0, y.shape[0] - 1, ROW_STEP)
+    y0, y1 = y[rows, 0::2], y[rows, 1::2]
+    below0, below1 = y[rows + 1, 0::2], y[rows + 1, 1::2]
+    u, v = u[rows], v[rows]
+    pairs = y0.size
+
+    chroma = np.bincount(((u >> 5) * 8 + (v >> 5)).ravel(), minlength=64) / pairs
+    luma = (np.bincount((y0 >> 5).ravel(), minlength=8) + np.bincount((y1 >> 5).ravel(), minlength=8)) / (2 * pairs)
+    horizontal = np.abs(y0 - y1).sum() / pairs / 255
+    vertical = (np.abs(y0 - below0).sum() + np.abs(y1 - below1).sum()) / (2 * pairs) / 255
+    return np.concatenate([chroma, luma, [horizontal, vertical]])
+
+def load_dataset(directory, class_names):
+    x, labels = [], []
+    for index, name in enumerate(class_names):
+        folder = os.path.join(directory, name)
+        for file in sorted(os.listdir(folder)):
+            if file.lower().endswith(('.jpg', '.jpeg', '.png')):
+                try:
+                    x.append(features(os.path.join(folder, file)))
+                    labels.append(index)
+                except OSError:
+                    print(f"Skipping unreadable image {file}")
+    return np.array(x, dtype=np.float64), np.array(labels)
+
+# ---- Softmax regression, full-batch gradient descent on standardized features ----
+def train(x, labels, classes):
+    mean, std = x.mean(axis=0), x.std(axis=0) + 1e-6
+    z = (x - mean) / std
+    onehot = np.eye(classes)[labels]
+    w = np.zeros((x.shape[1], classes))
+    b = np.zeros(classes)
+    for _ in range(EPOCHS):
+        p = softmax(z @ w + b)
+        w -= LEARNING_RATE * (z.T @ (p - onehot) / len(z) + L2 * w)
+        b -= LEARNING_RATE * (p - onehot).mean(axis=0)
+    # Fold the standardization in so the C++ side scores raw features
+    return w / std[:, None], b - (mean / std) @ w
+
+def softmax(scores):
+    e = np.exp(scores - scores.max(axis=1, keepdims=True))
+    return e / e.sum(axis=1, keepdims=True)
+
+# ---- Train ----
+with open(LABELS_PATH) as f:
+    class_names = [line.strip() for line in f if line.strip()]
+x, labels = load_dataset(TRAIN_DIR, class_names)
+print(f"{len(x)} images, {x.shape[1]} features")
+
+rng = np.random.default_rng(0)
+order = rng.permutation(len(x))
+n_val = int(len(x) * VALIDATION_SPLIT)
+val, fit = order[:n_val], order[n_val:]
+w, b = train(x[fit], labels[fit], len(class_names))
+
+# How often the cascade would stop early at each threshold, and how often it is right then
+if n_val:
+    p = softmax(x[val] @ w + b)
+    confidence, predicted = p.max(axis=1), p.argmax(axis=1)
+    print(f"Validation accuracy: {(predicted == labels[val]).mean():.3f}")
+    for threshold in (0.8, 0.9, 0.95, 0.99):
+        early = confidence >= threshold
+        accuracy = (predicted[early] == labels[val][early]).mean() if early.any() else float('nan')
+        print(f"  confidence >= {threshold}: {early.mean():.1%} resolved early, {accuracy:.3f} accurate")
+
+# Retrain on everything for the shipped weights
+w, b = train(x, labels, len(class_names))
+
+# ---- Save weights ----
+with open(WEIGHTS_SAVE_PATH, 'w') as f:
+    f.write(f"# Colour/texture pre-classifier, {len(x)} training images from {TRAIN_DIR}\n")
+    f.write(f"# Per class: bias, then {x.shape[1]} weights\n")
+    f.write("classes " + " ".join(class_names) + "\n")
+    for k in range(len(class_names)):
+        f.write(" ".join(f"{value:.8g}" for value in [b[k], *w[:, k]]) + "\n")
+
+print(f"? Pre-classifier weights saved as {WEIGHTS_SAVE_PATH}")